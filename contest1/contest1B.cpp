@@ -1,158 +1,927 @@
 #include <cassert>
 #include <cstdint>
 #include <algorithm>
+#include <array>
 #include <iostream>
+#include <limits>
+#include <numeric>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Montgomery form with R = 2^64: every product is reduced by two multiplications
+// and a shift instead of a hardware division. Works for odd moduli below 2^63,
+// the bound keeps t + m * mod inside 128 bits.
+template <uint64_t mod>
+struct MontgomeryReduction {
+  static_assert(mod % 2 == 1, "Montgomery reduction requires an odd modulus");
+  static_assert(mod < (uint64_t{1} << 63), "Modulus must be below 2^63");
+
+  static constexpr uint64_t toRing(uint64_t value) {
+    return reduce(static_cast<unsigned __int128>(value % mod) * squaredRadix);
+  }
+
+  static constexpr uint64_t fromRing(uint64_t value) { return reduce(value); }
+
+  static constexpr uint64_t multiply(uint64_t a, uint64_t b) {
+    return reduce(static_cast<unsigned __int128>(a) * b);
+  }
+
+  // value must be below mod * 2^64
+  static constexpr uint64_t reduce(unsigned __int128 value) {
+    uint64_t factor = static_cast<uint64_t>(value) * negatedInverse;
+    uint64_t result = static_cast<uint64_t>(
+        (value + static_cast<unsigned __int128>(factor) * mod) >> 64);
+
+    return result >= mod ? result - mod : result;
+  }
+
+  // products of reduced values whose sum may go through reduce at once
+  static constexpr size_t maxLazyProducts = UINT64_MAX / mod;
+
+ private:
+  static constexpr uint64_t findNegatedInverse() {
+    // Newton iteration, each step doubles the number of correct low bits
+    uint64_t inverse = mod;
+    for (int i = 0; i < 6; ++i) {
+      inverse *= 2 - mod * inverse;
+    }
+
+    return -inverse;
+  }
 
-template <uint32_t mod>
+  static constexpr uint64_t negatedInverse = findNegatedInverse();
+
+  static constexpr uint64_t radix = (0 - mod) % mod;
+  static constexpr uint64_t squaredRadix = static_cast<uint64_t>(
+      static_cast<unsigned __int128>(radix) * radix % mod);
+};
+
+// Barrett reduction keeps values in the ordinary form. Moduli below 2^32 replace
+// the division with one high multiplication, bigger ones (up to 2^63) fall back
+// to the 128-bit remainder so that products never overflow.
+template <uint64_t mod>
+struct BarrettReduction {
+  static_assert(mod != 0 && mod < (uint64_t{1} << 63),
+                "Modulus must be in [1, 2^63)");
+
+  static constexpr uint64_t toRing(uint64_t value) { return value % mod; }
+  static constexpr uint64_t fromRing(uint64_t value) { return value; }
+
+  static constexpr uint64_t multiply(uint64_t a, uint64_t b) {
+    return reduce(static_cast<unsigned __int128>(a) * b);
+  }
+
+  // for moduli below 2^32 value must be below 2^64
+  static constexpr uint64_t reduce(unsigned __int128 value) {
+    if constexpr (mod < (uint64_t{1} << 32)) {
+      uint64_t x = static_cast<uint64_t>(value);
+      uint64_t quotient = static_cast<uint64_t>(
+          (static_cast<unsigned __int128>(x) * factor) >> 64);
+      uint64_t result = x - quotient * mod;
+
+      return result >= mod ? result - mod : result;
+    } else {
+      return static_cast<uint64_t>(value % mod);
+    }
+  }
+
+ private:
+  static constexpr uint64_t factor = UINT64_MAX / mod;
+
+  static constexpr size_t findMaxLazyProducts() {
+    unsigned __int128 maxProduct =
+        static_cast<unsigned __int128>(mod - 1) * (mod - 1) + 1;
+    unsigned __int128 maxValue = mod < (uint64_t{1} << 32)
+                                     ? UINT64_MAX
+                                     : ~static_cast<unsigned __int128>(0);
+    unsigned __int128 res = maxValue / maxProduct;
+
+    return res < SIZE_MAX ? static_cast<size_t>(res) : SIZE_MAX;
+  }
+
+ public:
+  // products of reduced values whose sum may go through reduce at once
+  static constexpr size_t maxLazyProducts = findMaxLazyProducts();
+};
+
+template <typename T>
+struct DotProduct;
+
+template <uint64_t mod, typename Reduction = MontgomeryReduction<mod>>
 class ModuloRingUint64 {
+  // value in the internal form of Reduction
   uint64_t value_;
 
+  static constexpr ModuloRingUint64 fromRingValue(uint64_t ringValue) {
+    ModuloRingUint64 result;
+    result.value_ = ringValue;
+    return result;
+  }
+
  public:
-  ModuloRingUint64(uint64_t initVal = 0)
-      : value_(initVal % mod) {}
+  constexpr ModuloRingUint64(uint64_t initVal = 0)
+      : value_(Reduction::toRing(initVal)) {}
 
-  void value(uint64_t initVal) { value_ = initVal % mod; }
-  uint64_t value() const { return value_; }
+  constexpr void value(uint64_t initVal) { value_ = Reduction::toRing(initVal); }
+  constexpr uint64_t value() const { return Reduction::fromRing(value_); }
 
-  operator uint64_t() const { return value_; }
+  constexpr operator uint64_t() const { return value(); }
 
-  template <uint32_t modNew>
-  friend ModuloRingUint64<modNew> operator*(const ModuloRingUint64<modNew>& a,
-                                            const ModuloRingUint64<modNew>& b);
+  template <uint64_t modNew, typename ReductionNew>
+  friend constexpr ModuloRingUint64<modNew, ReductionNew> operator*(
+      const ModuloRingUint64<modNew, ReductionNew>& a,
+      const ModuloRingUint64<modNew, ReductionNew>& b);
 
-  ModuloRingUint64<mod>& operator*=(const ModuloRingUint64<mod>& other);
+  constexpr ModuloRingUint64& operator*=(const ModuloRingUint64& other);
 
-  template <uint32_t modNew>
-  friend ModuloRingUint64<modNew> operator+(const ModuloRingUint64<modNew>& a,
-                                            const ModuloRingUint64<modNew>& b);
+  template <uint64_t modNew, typename ReductionNew>
+  friend constexpr ModuloRingUint64<modNew, ReductionNew> operator+(
+      const ModuloRingUint64<modNew, ReductionNew>& a,
+      const ModuloRingUint64<modNew, ReductionNew>& b);
 
-  ModuloRingUint64<mod>& operator+=(const ModuloRingUint64<mod>& other);
+  constexpr ModuloRingUint64& operator+=(const ModuloRingUint64& other);
 
-  template <uint32_t modNew>
-  friend ModuloRingUint64<modNew> operator-(const ModuloRingUint64<modNew>& a,
-                                            const ModuloRingUint64<modNew>& b);
+  template <uint64_t modNew, typename ReductionNew>
+  friend constexpr ModuloRingUint64<modNew, ReductionNew> operator-(
+      const ModuloRingUint64<modNew, ReductionNew>& a,
+      const ModuloRingUint64<modNew, ReductionNew>& b);
+
+  template <typename U>
+  friend struct DotProduct;
 };
 
-template <uint32_t mod>
-ModuloRingUint64<mod> operator*(const ModuloRingUint64<mod>& a,
-                                const ModuloRingUint64<mod>& b) {
-  ModuloRingUint64<mod> result = a;
+template <uint64_t mod, typename Reduction>
+constexpr ModuloRingUint64<mod, Reduction> operator*(
+    const ModuloRingUint64<mod, Reduction>& a,
+    const ModuloRingUint64<mod, Reduction>& b) {
+  ModuloRingUint64<mod, Reduction> result = a;
   return result *= b;
 }
 
-template<uint32_t mod>
-ModuloRingUint64<mod>& ModuloRingUint64<mod>::operator*=(const ModuloRingUint64<mod>& other)
-{
-  value_ = (value_ * other.value_) % mod;
+template <uint64_t mod, typename Reduction>
+constexpr ModuloRingUint64<mod, Reduction>& ModuloRingUint64<mod, Reduction>::operator*=(
+    const ModuloRingUint64<mod, Reduction>& other) {
+  value_ = Reduction::multiply(value_, other.value_);
   return *this;
 }
 
-template <uint32_t mod>
-ModuloRingUint64<mod> operator+(const ModuloRingUint64<mod>& a,
-                                const ModuloRingUint64<mod>& b) {
-  ModuloRingUint64<mod> result = a;
+template <uint64_t mod, typename Reduction>
+constexpr ModuloRingUint64<mod, Reduction> operator+(
+    const ModuloRingUint64<mod, Reduction>& a,
+    const ModuloRingUint64<mod, Reduction>& b) {
+  ModuloRingUint64<mod, Reduction> result = a;
   return result += b;
 }
 
-template <uint32_t mod>
-ModuloRingUint64<mod> operator-(const ModuloRingUint64<mod>& a,
-                                const ModuloRingUint64<mod>& b) {
-  return (a.value_ - b.value_ + mod) % mod;
+template <uint64_t mod, typename Reduction>
+constexpr ModuloRingUint64<mod, Reduction> operator-(
+    const ModuloRingUint64<mod, Reduction>& a,
+    const ModuloRingUint64<mod, Reduction>& b) {
+  return ModuloRingUint64<mod, Reduction>::fromRingValue(
+      a.value_ >= b.value_ ? a.value_ - b.value_ : a.value_ + mod - b.value_);
 }
 
-template<uint32_t mod>
-ModuloRingUint64<mod>& ModuloRingUint64<mod>::operator+=(const ModuloRingUint64<mod>& other)
-{
-  value_ = (value_ + other.value_) % mod;
+template <uint64_t mod, typename Reduction>
+constexpr ModuloRingUint64<mod, Reduction>& ModuloRingUint64<mod, Reduction>::operator+=(
+    const ModuloRingUint64<mod, Reduction>& other) {
+  value_ += other.value_;
+  if (value_ >= mod) {
+    value_ -= mod;
+  }
+
   return *this;
 }
 
+// Sum of left(k) * right(k) over k < count, unrolled at compile time. The
+// generic version goes through the operators of T.
+template <typename T>
+struct DotProduct {
+  template <size_t count, typename Left, typename Right>
+  static constexpr T compute(Left left, Right right) {
+    return [&]<size_t... k>(std::index_sequence<k...>) {
+      T res = 0;
+      ((res += left(k) * right(k)), ...);
+      return res;
+    }(std::make_index_sequence<count>());
+  }
+};
+
+// Modular values are multiplied without reduction and the 128-bit sum is
+// reduced once, or once per maxLazyProducts terms for huge moduli.
+template <uint64_t mod, typename Reduction>
+struct DotProduct<ModuloRingUint64<mod, Reduction>> {
+  using RingType = ModuloRingUint64<mod, Reduction>;
+
+  template <size_t count, typename Left, typename Right>
+  static constexpr RingType compute(Left left, Right right) {
+    static_assert(Reduction::maxLazyProducts >= 1,
+                  "Modulus is too big for lazy reduction");
+
+    RingType res = 0;
+    unsigned __int128 sum = 0;
+    auto addProduct = [&]<size_t k>(std::integral_constant<size_t, k>) {
+      if constexpr (k != 0 && k % Reduction::maxLazyProducts == 0) {
+        res += RingType::fromRingValue(Reduction::reduce(sum));
+        sum = 0;
+      }
+
+      sum += static_cast<unsigned __int128>(RingType(left(k)).value_) *
+             RingType(right(k)).value_;
+    };
+
+    [&]<size_t... k>(std::index_sequence<k...>) {
+      (addProduct(std::integral_constant<size_t, k>()), ...);
+    }(std::make_index_sequence<count>());
+
+    return res + RingType::fromRingValue(Reduction::reduce(sum));
+  }
+};
+
 template <typename T, size_t size>
 struct Matrix {
-  T matrix[size][size];
+  std::array<std::array<T, size>, size> matrix;
 
-  Matrix() {
-    std::fill(&matrix[0][0], &matrix[0][0] + size * size, 0);
+  constexpr Matrix() : matrix() {
     for (size_t i = 0; i < size; ++i) {
+      matrix[i].fill(0);
       matrix[i][i] = 1;
     }
   }
 
   using InitMatrixType = const int (&)[size][size];
-  Matrix(InitMatrixType initMatrix) {
-    std::copy(&initMatrix[0][0], &initMatrix[0][0] + size * size, &matrix[0][0]);
+  constexpr Matrix(InitMatrixType initMatrix) : matrix() {
+    for (size_t i = 0; i < size; ++i) {
+      for (size_t j = 0; j < size; ++j) {
+        matrix[i][j] = initMatrix[i][j];
+      }
+    }
   }
 
-  Matrix<T, size>& operator*=(const Matrix<T, size>& other);
+  constexpr Matrix<T, size>& operator*=(const Matrix<T, size>& other);
 };
 
+// every entry of the product is one unrolled dot product
+template <typename T, size_t size>
+constexpr Matrix<T, size> operator*(const Matrix<T, size>& a,
+                                    const Matrix<T, size>& b) {
+  Matrix<T, size> res;
+
+  [&]<size_t... entry>(std::index_sequence<entry...>) {
+    ((res.matrix[entry / size][entry % size] = DotProduct<T>::template compute<size>(
+          [&](size_t k) { return a.matrix[entry / size][k]; },
+          [&](size_t k) { return b.matrix[k][entry % size]; })),
+     ...);
+  }(std::make_index_sequence<size * size>());
+
+  return res;
+}
+
+template<typename T, size_t size>
+constexpr Matrix<T, size>& Matrix<T, size>::operator*=(
+    const Matrix<T, size>& other) {
+  return *this = *this * other;
+}
+
+template <typename T, size_t size>
+constexpr std::array<T, size> operator*(const std::array<T, size>& row,
+                                        const Matrix<T, size>& matrix) {
+  std::array<T, size> res;
+
+  [&]<size_t... j>(std::index_sequence<j...>) {
+    ((res[j] = DotProduct<T>::template compute<size>(
+          [&](size_t k) { return row[k]; },
+          [&](size_t k) { return matrix.matrix[k][j]; })),
+     ...);
+  }(std::make_index_sequence<size>());
+
+  return res;
+}
+
+// table[k] = M^(2^k), built by the compiler
+template <typename T, size_t size>
+consteval std::array<Matrix<T, size>, 64> getSquaredPowers(
+    Matrix<T, size> matrix) {
+  std::array<Matrix<T, size>, 64> table;
+
+  table[0] = matrix;
+  for (size_t k = 1; k < table.size(); ++k) {
+    table[k] = table[k - 1] * table[k - 1];
+  }
+
+  return table;
+}
+
+// M^n as the product of the precomputed M^(2^k) for the set bits of n
 template <typename T, size_t size>
-Matrix<T, size> operator*(const Matrix<T, size>& a, const Matrix<T, size>& b) {
+constexpr Matrix<T, size> powBySquaredPowers(
+    const std::array<Matrix<T, size>, 64>& squaredPowers, uint64_t n) {
   Matrix<T, size> res;
 
-  for (size_t i = 0; i < size; ++i) {
-    for (size_t j = 0; j < size; ++j) {
-      res.matrix[i][j] = 0;
-      for (size_t k = 0; k < size; ++k) {
-        res.matrix[i][j] += a.matrix[i][k] * b.matrix[k][j];
+  for (size_t k = 0; n != 0; ++k, n /= 2) {
+    if (n % 2 == 1) {
+      res *= squaredPowers[k];
+    }
+  }
+
+  return res;
+}
+
+// Indices of keys in the ascending order of keys: LSD radix sort by 16-bit
+// digits, passes where all keys share the digit are skipped.
+std::vector<uint32_t> sortIndexesByKey(const std::vector<uint64_t>& keys) {
+  static const size_t DigitBits = 16;
+  static const size_t DigitValues = size_t{1} << DigitBits;
+
+  std::vector<uint32_t> order(keys.size()), buffer(keys.size());
+  std::iota(order.begin(), order.end(), 0);
+
+  std::vector<size_t> counts(DigitValues);
+  for (size_t shift = 0; shift < 64; shift += DigitBits) {
+    auto getDigit = [&](uint32_t index) {
+      return (keys[index] >> shift) & (DigitValues - 1);
+    };
+
+    std::fill(counts.begin(), counts.end(), 0);
+    for (uint32_t index : order) {
+      ++counts[getDigit(index)];
+    }
+
+    if (keys.empty() || counts[getDigit(order[0])] == keys.size()) {
+      continue;
+    }
+
+    size_t position = 0;
+    for (size_t& count : counts) {
+      size_t digitCount = count;
+      count = position;
+      position += digitCount;
+    }
+
+    for (uint32_t index : order) {
+      buffer[counts[getDigit(index)]++] = index;
+    }
+    order.swap(buffer);
+  }
+
+  return order;
+}
+
+// Top-left entries of M^e for many exponents e. M^(d * 2^(8 w)) is built once
+// for every byte value d and byte position w, so one exponent costs at most
+// eight vector-matrix products. Exponents are answered in sorted order and
+// every one reuses the products of the high bytes it shares with the previous.
+template <typename T, size_t size>
+class MatrixPowerQueries {
+ public:
+  explicit MatrixPowerQueries(const Matrix<T, size>& matrix);
+
+  // res[i] = (M^exponents[i])[0][0]
+  std::vector<T> getTopLeftEntries(const std::vector<uint64_t>& exponents) const;
+
+ private:
+  static const size_t WindowBits = 8;
+  static const size_t WindowValues = size_t{1} << WindowBits;
+  static const size_t NumWindows = 64 / WindowBits;
+
+  static size_t getDigit(uint64_t exponent, size_t window) {
+    return (exponent >> (window * WindowBits)) & (WindowValues - 1);
+  }
+
+  const Matrix<T, size>& getWindowPower(size_t window, size_t digit) const {
+    return windowPowers_[window * WindowValues + digit];
+  }
+
+  std::vector<Matrix<T, size>> windowPowers_;
+};
+
+template <typename T, size_t size>
+MatrixPowerQueries<T, size>::MatrixPowerQueries(const Matrix<T, size>& matrix) {
+  windowPowers_.reserve(NumWindows * WindowValues);
+
+  // M^(2^(8 w)) for the current window
+  Matrix<T, size> base = matrix;
+  for (size_t window = 0; window < NumWindows; ++window) {
+    windowPowers_.push_back(Matrix<T, size>());
+    for (size_t digit = 1; digit < WindowValues; ++digit) {
+      windowPowers_.push_back(windowPowers_.back() * base);
+    }
+
+    base = windowPowers_.back() * base;
+  }
+}
+
+template <typename T, size_t size>
+std::vector<T> MatrixPowerQueries<T, size>::getTopLeftEntries(
+    const std::vector<uint64_t>& exponents) const {
+  std::vector<uint32_t> order = sortIndexesByKey(exponents);
+
+  // rows[w] = e_0 * product of the window powers above w for the exponent
+  // answered last, rows[NumWindows] = e_0
+  std::array<std::array<T, size>, NumWindows + 1> rows;
+  rows[NumWindows].fill(0);
+  rows[NumWindows][0] = 1;
+
+  std::vector<T> res(exponents.size());
+
+  for (size_t i = 0; i < order.size(); ++i) {
+    uint64_t exponent = exponents[order[i]];
+
+    // windows below the highest byte that differs from the previous exponent
+    size_t nChangedWindows = NumWindows;
+    if (i != 0) {
+      uint64_t difference = exponent ^ exponents[order[i - 1]];
+      nChangedWindows =
+          difference == 0 ? 0
+                          : (63 - __builtin_clzll(difference)) / WindowBits + 1;
+    }
+
+    // rows[0] is only needed for its first entry
+    for (size_t window = nChangedWindows; window-- > 1;) {
+      size_t digit = getDigit(exponent, window);
+      if (digit == 0) {
+        rows[window] = rows[window + 1];
+      } else {
+        rows[window] = rows[window + 1] * getWindowPower(window, digit);
       }
     }
+
+    if (nChangedWindows != 0) {
+      const Matrix<T, size>& lowPower = getWindowPower(0, getDigit(exponent, 0));
+
+      rows[0][0] = DotProduct<T>::template compute<size>(
+          [&](size_t k) { return rows[1][k]; },
+          [&](size_t k) { return lowPower.matrix[k][0]; });
+    }
+
+    res[order[i]] = rows[0][0];
   }
 
   return res;
 }
 
-template<typename T, size_t size>
-Matrix<T, size>& Matrix<T, size>::operator*=(const Matrix<T, size>& other)
-{
-  return *this = *this * other;
+constexpr uint64_t powMod(uint64_t base, uint64_t exponent, uint64_t mod) {
+  unsigned __int128 result = 1 % mod;
+  unsigned __int128 value = base % mod;
+
+  while (exponent != 0) {
+    if (exponent % 2 == 1) {
+      result = result * value % mod;
+    }
+
+    value = value * value % mod;
+    exponent /= 2;
+  }
+
+  return static_cast<uint64_t>(result);
+}
+
+template <typename T>
+using Polynomial = std::vector<T>;
+
+template <typename T>
+Polynomial<T> multiplySchoolbook(const Polynomial<T>& a,
+                                 const Polynomial<T>& b) {
+  if (a.empty() || b.empty()) {
+    return {};
+  }
+
+  Polynomial<T> res(a.size() + b.size() - 1, T(0));
+
+  for (size_t i = 0; i < a.size(); ++i) {
+    for (size_t j = 0; j < b.size(); ++j) {
+      res[i + j] += a[i] * b[j];
+    }
+  }
+
+  return res;
+}
+
+// all three primes are c * 2^k + 1 with primitive root 3
+const uint64_t NttPrime1 = 998244353;
+const uint64_t NttPrime2 = 167772161;
+const uint64_t NttPrime3 = 469762049;
+const uint64_t NttPrimitiveRoot = 3;
+
+template <uint64_t prime>
+void transformNtt(std::vector<ModuloRingUint64<prime>>& values, bool inverse) {
+  using RingType = ModuloRingUint64<prime>;
+
+  size_t size = values.size();
+  assert((size & (size - 1)) == 0);
+  assert((prime - 1) % size == 0);
+
+  for (size_t i = 1, j = 0; i < size; ++i) {
+    size_t bit = size >> 1;
+    for (; j & bit; bit >>= 1) {
+      j ^= bit;
+    }
+    j ^= bit;
+
+    if (i < j) {
+      std::swap(values[i], values[j]);
+    }
+  }
+
+  for (size_t len = 2; len <= size; len *= 2) {
+    uint64_t rootPower = (prime - 1) / len;
+    if (inverse) {
+      rootPower = prime - 1 - rootPower;
+    }
+    RingType root = powMod(NttPrimitiveRoot, rootPower, prime);
+
+    for (size_t begin = 0; begin < size; begin += len) {
+      RingType factor = 1;
+      for (size_t i = 0; i < len / 2; ++i) {
+        RingType first = values[begin + i];
+        RingType second = values[begin + i + len / 2] * factor;
+
+        values[begin + i] = first + second;
+        values[begin + i + len / 2] = first - second;
+        factor *= root;
+      }
+    }
+  }
+
+  if (inverse) {
+    RingType sizeInverse = powMod(size, prime - 2, prime);
+    for (size_t i = 0; i < size; ++i) {
+      values[i] *= sizeInverse;
+    }
+  }
+}
+
+template <uint64_t prime>
+std::vector<uint64_t> convolveModPrime(const std::vector<uint64_t>& a,
+                                       const std::vector<uint64_t>& b,
+                                       size_t transformSize) {
+  using RingType = ModuloRingUint64<prime>;
+
+  std::vector<RingType> first(transformSize, RingType(0));
+  std::vector<RingType> second(transformSize, RingType(0));
+  std::copy(a.begin(), a.end(), first.begin());
+  std::copy(b.begin(), b.end(), second.begin());
+
+  transformNtt(first, false);
+  transformNtt(second, false);
+  for (size_t i = 0; i < transformSize; ++i) {
+    first[i] *= second[i];
+  }
+  transformNtt(first, true);
+
+  std::vector<uint64_t> res(a.size() + b.size() - 1);
+  for (size_t i = 0; i < res.size(); ++i) {
+    res[i] = first[i].value();
+  }
+
+  return res;
+}
+
+// Convolution over three NTT primes glued together with Garner's algorithm.
+// Exact as long as every coefficient of the integer product is below
+// NttPrime1 * NttPrime2 * NttPrime3 (about 2^86).
+template <typename T>
+Polynomial<T> multiplyNtt(const Polynomial<T>& a, const Polynomial<T>& b) {
+  if (a.empty() || b.empty()) {
+    return {};
+  }
+
+  std::vector<uint64_t> first(a.size()), second(b.size());
+  for (size_t i = 0; i < a.size(); ++i) {
+    first[i] = a[i].value();
+  }
+  for (size_t i = 0; i < b.size(); ++i) {
+    second[i] = b[i].value();
+  }
+
+  size_t transformSize = 1;
+  while (transformSize < a.size() + b.size() - 1) {
+    transformSize *= 2;
+  }
+
+  auto residues1 = convolveModPrime<NttPrime1>(first, second, transformSize);
+  auto residues2 = convolveModPrime<NttPrime2>(first, second, transformSize);
+  auto residues3 = convolveModPrime<NttPrime3>(first, second, transformSize);
+
+  using Ring2 = ModuloRingUint64<NttPrime2>;
+  using Ring3 = ModuloRingUint64<NttPrime3>;
+
+  static const Ring2 prime1Inverse = powMod(NttPrime1, NttPrime2 - 2, NttPrime2);
+  static const Ring3 prime12Inverse =
+      powMod(NttPrime1 * NttPrime2 % NttPrime3, NttPrime3 - 2, NttPrime3);
+
+  const T prime1 = NttPrime1;
+  const T prime12 = T(NttPrime1) * T(NttPrime2);
+
+  Polynomial<T> res(residues1.size(), T(0));
+  for (size_t i = 0; i < res.size(); ++i) {
+    uint64_t x1 = residues1[i];
+    uint64_t x2 = ((Ring2(residues2[i]) - Ring2(x1)) * prime1Inverse).value();
+    uint64_t x3 = ((Ring3(residues3[i]) - Ring3(x1) -
+                    Ring3(x2) * Ring3(NttPrime1)) *
+                   prime12Inverse)
+                      .value();
+
+    res[i] = T(x1) + T(x2) * prime1 + T(x3) * prime12;
+  }
+
+  return res;
+}
+
+const size_t NttThreshold = 512;
+
+template <typename T>
+Polynomial<T> multiply(const Polynomial<T>& a, const Polynomial<T>& b) {
+  if (std::min(a.size(), b.size()) <= NttThreshold) {
+    return multiplySchoolbook(a, b);
+  }
+
+  return multiplyNtt(a, b);
+}
+
+// Reduction modulo a fixed monic polynomial of degree k. Small degrees use long
+// division, bigger ones precompute 1 / rev(modulus) and get the quotient with
+// two multiplications.
+template <typename T>
+class PolynomialModulus {
+ public:
+  explicit PolynomialModulus(const Polynomial<T>& modulus);
+
+  size_t degree() const { return modulus_.size() - 1; }
+
+  // value must have degree below 2 * degree()
+  Polynomial<T> reduce(Polynomial<T> value) const;
+
+  // (value * x) mod modulus for value already reduced
+  Polynomial<T> multiplyByX(const Polynomial<T>& value) const;
+
+ private:
+  Polynomial<T> reduceSchoolbook(Polynomial<T> value) const;
+
+  Polynomial<T> modulus_;
+  Polynomial<T> reversedInverse_;
+};
+
+template <typename T>
+Polynomial<T> invertSeries(const Polynomial<T>& series, size_t precision) {
+  assert(!series.empty() && series[0].value() == 1);
+
+  Polynomial<T> inverse = {T(1)};
+  for (size_t len = 1; len < precision;) {
+    len = std::min(2 * len, precision);
+
+    Polynomial<T> seriesPrefix(series.begin(),
+                               series.begin() + std::min(len, series.size()));
+    Polynomial<T> product = multiply(seriesPrefix, inverse);
+    product.resize(len, T(0));
+
+    // inverse = inverse * (2 - series * inverse)
+    for (size_t i = 0; i < len; ++i) {
+      product[i] = T(0) - product[i];
+    }
+    product[0] += T(2);
+
+    inverse = multiply(inverse, product);
+    inverse.resize(len, T(0));
+  }
+
+  return inverse;
+}
+
+template <typename T>
+PolynomialModulus<T>::PolynomialModulus(const Polynomial<T>& modulus)
+    : modulus_(modulus) {
+  assert(modulus_.size() >= 2 && modulus_.back().value() == 1);
+
+  size_t k = degree();
+  if (k > NttThreshold) {
+    Polynomial<T> reversed(modulus_.rbegin(), modulus_.rend());
+    reversedInverse_ = invertSeries(reversed, k - 1);
+  }
+}
+
+template <typename T>
+Polynomial<T> PolynomialModulus<T>::reduceSchoolbook(
+    Polynomial<T> value) const {
+  size_t k = degree();
+
+  for (size_t i = value.size(); i-- > k;) {
+    T top = value[i];
+    for (size_t j = 0; j < k; ++j) {
+      value[i - k + j] = value[i - k + j] - top * modulus_[j];
+    }
+  }
+
+  value.resize(k, T(0));
+  return value;
 }
 
 template <typename T>
-T pow(const T value, const uint64_t n) {
-  T result{};
+Polynomial<T> PolynomialModulus<T>::reduce(Polynomial<T> value) const {
+  size_t k = degree();
+  if (value.size() <= k) {
+    value.resize(k, T(0));
+    return value;
+  }
+
+  if (reversedInverse_.empty()) {
+    return reduceSchoolbook(std::move(value));
+  }
+
+  assert(value.size() <= 2 * k - 1);
+
+  // rev(quotient) = rev(value) / rev(modulus) mod x^(deg value - k + 1)
+  size_t quotientSize = value.size() - k;
+  Polynomial<T> reversedValue(value.rbegin(),
+                              value.rbegin() + quotientSize);
+  Polynomial<T> inversePrefix(reversedInverse_.begin(),
+                              reversedInverse_.begin() + quotientSize);
 
-  uint64_t power = n;
-  T val = value;
+  Polynomial<T> quotient = multiply(reversedValue, inversePrefix);
+  quotient.resize(quotientSize, T(0));
+  std::reverse(quotient.begin(), quotient.end());
 
-  while (power != 0) {
-    if (power % 2 == 1) {
-      result *= val;
+  Polynomial<T> product = multiply(quotient, modulus_);
+
+  Polynomial<T> remainder(k);
+  for (size_t i = 0; i < k; ++i) {
+    remainder[i] = value[i] - product[i];
+  }
+
+  return remainder;
+}
+
+template <typename T>
+Polynomial<T> PolynomialModulus<T>::multiplyByX(
+    const Polynomial<T>& value) const {
+  size_t k = degree();
+  assert(value.size() == k);
+
+  T top = value[k - 1];
+
+  Polynomial<T> res(k, T(0));
+  for (size_t i = k - 1; i > 0; --i) {
+    res[i] = value[i - 1];
+  }
+
+  for (size_t i = 0; i < k; ++i) {
+    res[i] = res[i] - top * modulus_[i];
+  }
+
+  return res;
+}
+
+template <typename T>
+struct LinearRecurrence {
+  // a(i) = coefficients[0] * a(i - 1) + ... + coefficients[k - 1] * a(i - k)
+  std::vector<T> coefficients;
+  // a(1), ..., a(k)
+  std::vector<T> initialTerms;
+};
+
+// Kitamasa: a(n) = sum of r_i * a(i + 1) where r = x^(n - 1) mod the
+// characteristic polynomial. Costs O(k^2 log n) with long multiplication and
+// O(k log k log n) with NTT, multiply() picks one from k.
+template <typename T>
+T getRecurrenceTerm(const LinearRecurrence<T>& recurrence, uint64_t n) {
+  size_t k = recurrence.coefficients.size();
+  assert(k >= 1 && recurrence.initialTerms.size() == k);
+  assert(n >= 1);
+
+  if (n <= k) {
+    return recurrence.initialTerms[n - 1];
+  }
+
+  // x^k - c_1 x^(k - 1) - ... - c_k
+  Polynomial<T> characteristic(k + 1, T(0));
+  characteristic[k] = T(1);
+  for (size_t i = 0; i < k; ++i) {
+    characteristic[k - 1 - i] = T(0) - recurrence.coefficients[i];
+  }
+
+  PolynomialModulus<T> modulus(characteristic);
+
+  uint64_t power = n - 1;
+  int highestBit = 63;
+  while ((power >> highestBit) == 0) {
+    --highestBit;
+  }
+
+  Polynomial<T> remainder(k, T(0));
+  remainder[0] = T(1);
+  for (int bit = highestBit; bit >= 0; --bit) {
+    remainder = modulus.reduce(multiply(remainder, remainder));
+    if ((power >> bit) & 1) {
+      remainder = modulus.multiplyByX(remainder);
     }
+  }
 
-    val *= val;
-    power /= 2;
+  T term = 0;
+  for (size_t i = 0; i < k; ++i) {
+    term += remainder[i] * recurrence.initialTerms[i];
   }
 
-  return result;
+  return term;
 }
 
+const uint64_t AnswerMod = 1000003;
+using AnswerRingType = ModuloRingUint64<AnswerMod>;
+
+const size_t AnswerMatrixSize = 5;
+
+constexpr Matrix<AnswerRingType, AnswerMatrixSize> createAnswerMatrix() {
+  return Matrix<AnswerRingType, AnswerMatrixSize>({{1, 1, 1, 1, 1},
+                                                   {1, 0, 0, 0, 0},
+                                                   {0, 1, 0, 0, 0},
+                                                   {0, 0, 1, 0, 0},
+                                                   {0, 0, 0, 1, 0}});
+}
+
+constexpr std::array<Matrix<AnswerRingType, AnswerMatrixSize>, 64>
+    AnswerSquaredPowers = getSquaredPowers(createAnswerMatrix());
+
 uint64_t getAnswer(uint64_t n) {
   if (n == 1) {
     return 1;
   }
 
-  const uint32_t mod = 1000003;
-  const size_t matrixSize = 5;
+  using RingType = AnswerRingType;
+
+  Matrix<RingType, AnswerMatrixSize> resultMatrix =
+      powBySquaredPowers(AnswerSquaredPowers, n - 1);
 
-  using RingType = ModuloRingUint64<mod>;
+  return resultMatrix.matrix[0][0];
+}
 
-  Matrix<RingType, matrixSize> matrix({{1, 1, 1, 1, 1},
-                                       {1, 0, 0, 0, 0},
-                                       {0, 1, 0, 0, 0},
-                                       {0, 0, 1, 0, 0},
-                                       {0, 0, 0, 1, 0}});
+// every n of the input until its end, answers in the same order
+void answerBatch() {
+  std::vector<uint64_t> exponents;
+  for (uint64_t n = 0; std::cin >> n;) {
+    assert(n >= 1);
+    exponents.push_back(n - 1);
+  }
 
-  Matrix<RingType, matrixSize> resultMatrix = pow(matrix, n - 1);
+  MatrixPowerQueries<AnswerRingType, AnswerMatrixSize> queries(
+      createAnswerMatrix());
+  std::vector<AnswerRingType> answers = queries.getTopLeftEntries(exponents);
 
-  return resultMatrix.matrix[0][0];
+  std::string output;
+  for (const AnswerRingType& answer : answers) {
+    output += std::to_string(answer.value());
+    output += '\n';
+  }
+
+  std::cout << output;
 }
 
-int main() {
+// optional tail of the input: k, then c_1 ... c_k, then a(1) ... a(k)
+bool readRecurrence(LinearRecurrence<AnswerRingType>& recurrence) {
+  size_t order = 0;
+  if (!(std::cin >> order) || order == 0) {
+    return false;
+  }
+
+  recurrence.coefficients.resize(order);
+  recurrence.initialTerms.resize(order);
+
+  for (size_t i = 0; i < order; ++i) {
+    uint64_t coefficient = 0;
+    std::cin >> coefficient;
+    recurrence.coefficients[i] = coefficient;
+  }
+  for (size_t i = 0; i < order; ++i) {
+    uint64_t term = 0;
+    std::cin >> term;
+    recurrence.initialTerms[i] = term;
+  }
+
+  return true;
+}
+
+int main(int argc, char* argv[]) {
+  std::ios::sync_with_stdio(false);
+  std::cin.tie(nullptr);
+
+  bool isBatchMode = argc == 2 && std::string_view(argv[1]) == "--batch";
+  if (argc > 1 && !isBatchMode) {
+    std::cerr << "Usage: " << argv[0] << " [--batch]\n";
+    return 1;
+  }
+
+  if (isBatchMode) {
+    answerBatch();
+    return 0;
+  }
+
   uint64_t n = 0;
   std::cin >> n;
 
-  uint64_t ans = getAnswer(n);
+  LinearRecurrence<AnswerRingType> recurrence;
+
+  uint64_t ans = readRecurrence(recurrence)
+                     ? getRecurrenceTerm(recurrence, n).value()
+                     : getAnswer(n);
 
   std::cout << ans << "\n";
 }
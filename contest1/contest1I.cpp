@@ -1,8 +1,12 @@
 #include <algorithm>
 #include <cassert>
 #include <cmath>
+#include <functional>
 #include <iostream>
 #include <iterator>
+#include <map>
+#include <memory>
+#include <string_view>
 #include <vector>
 
 struct MaxAreaInfo {
@@ -46,36 +50,114 @@ std::vector<int> restoreAreasToCaptureBasedOnAreasDP(
   return areasToCapture;
 }
 
-std::vector<IthAreaInfo> calculateAreasDP(
-    const std::vector<int>& numberOfGangstersInAreas,
-    bool sequenceCondition(int)) {
-  std::vector<IthAreaInfo> areasDP(numberOfGangstersInAreas.size());
-
-  for (size_t i = 1; i < numberOfGangstersInAreas.size(); ++i) {
-    for (size_t j = 0; j < i; ++j) {
-      if (areasDP[i].areasGot < areasDP[j].areasGot + 1) {
-        if (sequenceCondition(areasDP[j].areasGot) &&
-            numberOfGangstersInAreas[j] > numberOfGangstersInAreas[i]) {
-          areasDP[i].areasGot = areasDP[j].areasGot + 1;
-          areasDP[i].prevArea = j;
-        } else if (!sequenceCondition(areasDP[j].areasGot) &&
-                   numberOfGangstersInAreas[j] < numberOfGangstersInAreas[i]) {
-          areasDP[i].areasGot = areasDP[j].areasGot + 1;
-          areasDP[i].prevArea = j;
-        }
+// Area to continue a sequence from: the longer sequence wins, the earlier
+// area breaks ties, which is the choice of the quadratic scan over areas.
+struct AreaCandidate {
+  int areasGot = 0;
+  int index = -1;
+
+  bool isBetterThan(const AreaCandidate& other) const {
+    return areasGot > other.areasGot ||
+           (areasGot == other.areasGot && index < other.index);
+  }
+};
+
+// Fenwick tree of the best candidate over prefixes of positions, positions
+// only ever get better candidates.
+class MaxFenwickTree {
+ public:
+  explicit MaxFenwickTree(size_t size) : tree_(size + 1) {}
+
+  void update(size_t position, const AreaCandidate& candidate) {
+    for (size_t i = position + 1; i < tree_.size(); i += i & (~i + 1)) {
+      if (candidate.isBetterThan(tree_[i])) {
+        tree_[i] = candidate;
       }
     }
   }
 
-  return areasDP;
+  // best candidate over positions [0, end)
+  AreaCandidate getPrefixMax(size_t end) const {
+    AreaCandidate res;
+    for (size_t i = end; i > 0; i -= i & (~i + 1)) {
+      if (tree_[i].isBetterThan(res)) {
+        res = tree_[i];
+      }
+    }
+
+    return res;
+  }
+
+ private:
+  std::vector<AreaCandidate> tree_;
+};
+
+// positions of the values among their sorted distinct values
+std::vector<size_t> compressValues(const std::vector<int>& values,
+                                   size_t& nDistinctValues) {
+  std::vector<int> sortedValues = values;
+  std::sort(sortedValues.begin(), sortedValues.end());
+  sortedValues.erase(std::unique(sortedValues.begin(), sortedValues.end()),
+                     sortedValues.end());
+  nDistinctValues = sortedValues.size();
+
+  std::vector<size_t> ranks(values.size());
+  for (size_t i = 0; i < values.size(); ++i) {
+    ranks[i] = std::lower_bound(sortedValues.begin(), sortedValues.end(),
+                                values[i]) -
+               sortedValues.begin();
+  }
+
+  return ranks;
 }
 
-std::vector<int> findAreasToCaptureWithSequenceConditionStrategy(
+// One pass over the areas for all sequence conditions at once, O(n log n) per
+// condition. Area j continues to area i when sequenceCondition(areasGot of j)
+// holds and the count drops, or when it does not hold and the count grows, so
+// every condition keeps a tree of the areas of either kind: one over the
+// reversed counts for "bigger than", one over the counts for "smaller than".
+std::vector<std::vector<IthAreaInfo>> calculateAreasDPs(
     const std::vector<int>& numberOfGangstersInAreas,
-    bool sequenceCondition(int)) {
-  return restoreAreasToCaptureBasedOnAreasDP(
-      numberOfGangstersInAreas,
-      calculateAreasDP(numberOfGangstersInAreas, sequenceCondition));
+    const std::vector<bool (*)(int)>& sequenceConditions) {
+  const size_t nAreas = numberOfGangstersInAreas.size();
+
+  size_t nValues = 0;
+  std::vector<size_t> ranks = compressValues(numberOfGangstersInAreas, nValues);
+
+  std::vector<std::vector<IthAreaInfo>> areasDPs(
+      sequenceConditions.size(), std::vector<IthAreaInfo>(nAreas));
+  std::vector<MaxFenwickTree> biggerCountTrees(sequenceConditions.size(),
+                                               MaxFenwickTree(nValues));
+  std::vector<MaxFenwickTree> smallerCountTrees(sequenceConditions.size(),
+                                                MaxFenwickTree(nValues));
+
+  for (size_t i = 0; i < nAreas; ++i) {
+    const size_t rank = ranks[i];
+    const size_t reversedRank = nValues - 1 - rank;
+
+    for (size_t k = 0; k < sequenceConditions.size(); ++k) {
+      AreaCandidate best = biggerCountTrees[k].getPrefixMax(reversedRank);
+      AreaCandidate smallerBest = smallerCountTrees[k].getPrefixMax(rank);
+      if (smallerBest.isBetterThan(best)) {
+        best = smallerBest;
+      }
+
+      IthAreaInfo& areaInfo = areasDPs[k][i];
+      if (best.index != -1) {
+        areaInfo.areasGot = best.areasGot + 1;
+        areaInfo.prevArea = best.index;
+      }
+
+      AreaCandidate candidate{areaInfo.areasGot, static_cast<int>(i)};
+      if (sequenceConditions[k](areaInfo.areasGot)) {
+        biggerCountTrees[k].update(reversedRank, candidate);
+      } else {
+        smallerCountTrees[k].update(rank, candidate);
+      }
+    }
+  }
+
+  return areasDPs;
 }
 
 bool isEven(int x) { return x % 2 == 0; }
@@ -83,12 +165,13 @@ bool isOdd(int x) { return x % 2 == 1; }
 
 std::vector<int> findAreasToCapture(
     const std::vector<int>& numberOfGangstersInAreas) {
-  auto areasToCaptureStrategy1 =
-      findAreasToCaptureWithSequenceConditionStrategy(numberOfGangstersInAreas,
-                                                      isEven);
-  auto areasToCaptureStrategy2 =
-      findAreasToCaptureWithSequenceConditionStrategy(numberOfGangstersInAreas,
-                                                      isOdd);
+  auto areasDPs =
+      calculateAreasDPs(numberOfGangstersInAreas, {isEven, isOdd});
+
+  auto areasToCaptureStrategy1 = restoreAreasToCaptureBasedOnAreasDP(
+      numberOfGangstersInAreas, areasDPs[0]);
+  auto areasToCaptureStrategy2 = restoreAreasToCaptureBasedOnAreasDP(
+      numberOfGangstersInAreas, areasDPs[1]);
 
   if (areasToCaptureStrategy1.size() < areasToCaptureStrategy2.size()) {
     return areasToCaptureStrategy2;
@@ -97,6 +180,181 @@ std::vector<int> findAreasToCapture(
   return areasToCaptureStrategy1;
 }
 
+// Area of a streamed sequence that is still reachable, either as a possible
+// predecessor of future areas or through the chain of the current best one.
+struct AreaNode {
+  int numberOfGangsters;
+  int areasGot;
+  size_t index;
+  std::shared_ptr<AreaNode> prevArea;
+
+  AreaNode(int numberOfGangsters, int areasGot, size_t index,
+           std::shared_ptr<AreaNode> prevArea)
+      : numberOfGangsters(numberOfGangsters),
+        areasGot(areasGot),
+        index(index),
+        prevArea(std::move(prevArea)) {}
+
+  // unlinks the chain iteratively, a recursive release of a long chain would
+  // overflow the stack
+  ~AreaNode() {
+    std::shared_ptr<AreaNode> prev = std::move(prevArea);
+    while (prev && prev.use_count() == 1) {
+      prev = std::move(prev->prevArea);
+    }
+  }
+};
+
+// Areas that may precede a new area whose count comes after theirs in Compare
+// order, keyed by count. Only areas no other one beats are kept: an area with
+// an earlier count and a longer sequence (or an equal one and an earlier
+// index) answers every query the later one does. Along the keys the sequence
+// lengths therefore never decrease, and the best area for a count is the last
+// one before it.
+template <typename Compare>
+class AreaStaircase {
+ public:
+  // best area with a count before numberOfGangsters, nullptr if none
+  const std::shared_ptr<AreaNode>* findBest(int numberOfGangsters) const {
+    auto it = areas_.lower_bound(numberOfGangsters);
+    if (it == areas_.begin()) {
+      return nullptr;
+    }
+
+    return &std::prev(it)->second;
+  }
+
+  void insert(const std::shared_ptr<AreaNode>& area) {
+    auto it = areas_.upper_bound(area->numberOfGangsters);
+    if (it != areas_.begin() &&
+        std::prev(it)->second->areasGot >= area->areasGot) {
+      return;
+    }
+
+    it = areas_.lower_bound(area->numberOfGangsters);
+    while (it != areas_.end() && it->second->areasGot < area->areasGot) {
+      it = areas_.erase(it);
+    }
+
+    areas_.emplace_hint(it, area->numberOfGangsters, area);
+  }
+
+ private:
+  std::map<int, std::shared_ptr<AreaNode>, Compare> areas_;
+};
+
+// Online version of findAreasToCapture: counts are pushed one at a time, the
+// best length is known after every push and the sequence is restored on
+// demand. Memory is the staircases plus the predecessor chains they and the
+// best areas reach, areas nothing points to are released.
+class AreaCaptureStream {
+ public:
+  AreaCaptureStream();
+
+  // O(log n) amortized
+  void push(int numberOfGangsters);
+
+  size_t getMaxAreasCount() const;
+
+  std::vector<int> getAreasToCapture() const;
+
+ private:
+  struct StrategyState {
+    bool (*sequenceCondition)(int);
+    // areas whose successor must have fewer gangsters
+    AreaStaircase<std::greater<int>> biggerCountAreas;
+    // areas whose successor must have more gangsters
+    AreaStaircase<std::less<int>> smallerCountAreas;
+    // last area of the longest sequence, the earliest one among equals
+    std::shared_ptr<AreaNode> bestArea;
+  };
+
+  const StrategyState& getBestStrategy() const;
+
+  std::vector<StrategyState> strategies_;
+  size_t nAreas_ = 0;
+};
+
+AreaCaptureStream::AreaCaptureStream() {
+  for (bool (*sequenceCondition)(int) : {isEven, isOdd}) {
+    strategies_.push_back(StrategyState{sequenceCondition, {}, {}, nullptr});
+  }
+}
+
+void AreaCaptureStream::push(int numberOfGangsters) {
+  for (StrategyState& strategy : strategies_) {
+    const std::shared_ptr<AreaNode>* bigger =
+        strategy.biggerCountAreas.findBest(numberOfGangsters);
+    const std::shared_ptr<AreaNode>* smaller =
+        strategy.smallerCountAreas.findBest(numberOfGangsters);
+
+    std::shared_ptr<AreaNode> prevArea;
+    if (bigger != nullptr) {
+      prevArea = *bigger;
+    }
+    if (smaller != nullptr &&
+        (!prevArea || (*smaller)->areasGot > prevArea->areasGot ||
+         ((*smaller)->areasGot == prevArea->areasGot &&
+          (*smaller)->index < prevArea->index))) {
+      prevArea = *smaller;
+    }
+
+    int areasGot = prevArea ? prevArea->areasGot + 1 : 1;
+    auto area = std::make_shared<AreaNode>(numberOfGangsters, areasGot, nAreas_,
+                                           std::move(prevArea));
+
+    if (strategy.sequenceCondition(areasGot)) {
+      strategy.biggerCountAreas.insert(area);
+    } else {
+      strategy.smallerCountAreas.insert(area);
+    }
+
+    if (!strategy.bestArea || strategy.bestArea->areasGot < areasGot) {
+      strategy.bestArea = std::move(area);
+    }
+  }
+
+  ++nAreas_;
+}
+
+const AreaCaptureStream::StrategyState& AreaCaptureStream::getBestStrategy()
+    const {
+  // the first strategy wins ties, as in findAreasToCapture
+  const StrategyState* best = &strategies_[0];
+  for (const StrategyState& strategy : strategies_) {
+    if (strategy.bestArea &&
+        strategy.bestArea->areasGot > best->bestArea->areasGot) {
+      best = &strategy;
+    }
+  }
+
+  return *best;
+}
+
+size_t AreaCaptureStream::getMaxAreasCount() const {
+  if (nAreas_ == 0) {
+    return 0;
+  }
+
+  return getBestStrategy().bestArea->areasGot;
+}
+
+std::vector<int> AreaCaptureStream::getAreasToCapture() const {
+  if (nAreas_ == 0) {
+    return {};
+  }
+
+  std::vector<int> areasToCapture;
+  for (const AreaNode* area = getBestStrategy().bestArea.get();
+       area != nullptr; area = area->prevArea.get()) {
+    areasToCapture.push_back(area->numberOfGangsters);
+  }
+
+  std::reverse(areasToCapture.begin(), areasToCapture.end());
+
+  return areasToCapture;
+}
+
 std::vector<int> readInput() {
   size_t nAreas = 0;
   std::cin >> nAreas;
@@ -114,7 +372,33 @@ void printAreasToCapture(const std::vector<int>& areasToCapture) {
             std::ostream_iterator<int>(std::cout, " "));
 }
 
-int main() {
+// same input and output as readInput and findAreasToCapture, but the counts
+// are consumed as they are read
+std::vector<int> captureAreasFromStream() {
+  size_t nAreas = 0;
+  std::cin >> nAreas;
+
+  AreaCaptureStream stream;
+  int numberOfGangsters = 0;
+  for (size_t i = 0; i < nAreas && std::cin >> numberOfGangsters; ++i) {
+    stream.push(numberOfGangsters);
+  }
+
+  return stream.getAreasToCapture();
+}
+
+int main(int argc, char* argv[]) {
+  bool isStreamMode = argc == 2 && std::string_view(argv[1]) == "--stream";
+  if (argc > 1 && !isStreamMode) {
+    std::cerr << "Usage: " << argv[0] << " [--stream]\n";
+    return 1;
+  }
+
+  if (isStreamMode) {
+    printAreasToCapture(captureAreasFromStream());
+    return 0;
+  }
+
   std::vector<int> numberOfGangstersInAreas = readInput();
 
   std::vector<int> areasToCapture =
@@ -1,11 +1,22 @@
 #include <algorithm>
+#include <bit>
 #include <cassert>
 #include <cmath>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
 #include <iostream>
+#include <mutex>
+#include <optional>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <vector>
 
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
 const int InvalidIndex = -2;
 
 struct IthLcsInfo {
@@ -41,38 +52,30 @@ std::vector<std::pair<size_t, size_t>> getLcsIndexes(
   return indexes;
 }
 
-std::vector<std::pair<size_t, size_t>> getLcs(std::string_view firstWord,
-                                              std::string_view secondWord) {
+// Whole table of cells, the outside row and column count as zeros.
+std::vector<std::pair<size_t, size_t>> getLcsFullTable(
+    std::string_view firstWord, std::string_view secondWord) {
   size_t firstWordSize = firstWord.size();
   size_t secondWordSize = secondWord.size();
 
   std::vector<std::vector<IthLcsInfo>> lcsDP(
       firstWordSize, std::vector<IthLcsInfo>(secondWordSize));
 
-  for (size_t i = 0; i < firstWordSize; ++i) {
-    if (firstWord[i] == secondWord[0]) {
-      lcsDP[i][0].lcs = 1;
-      lcsDP[i][0].prevIndex = {i - 1, -1};
-    }
-  }
-  for (size_t i = 0; i < secondWordSize; ++i) {
-    if (firstWord[0] == secondWord[i]) {
-      lcsDP[0][i].lcs = 1;
-      lcsDP[0][i].prevIndex = {-1, i - 1};
-    }
-  }
+  auto getLcsAt = [&lcsDP](size_t i, size_t j) {
+    return i == 0 || j == 0 ? 0 : lcsDP[i - 1][j - 1].lcs;
+  };
 
-  for (size_t i = 1; i < firstWordSize; ++i) {
-    for (size_t j = 1; j < secondWordSize; ++j) {
+  for (size_t i = 0; i < firstWordSize; ++i) {
+    for (size_t j = 0; j < secondWordSize; ++j) {
       if (firstWord[i] == secondWord[j]) {
-        lcsDP[i][j].lcs = lcsDP[i - 1][j - 1].lcs + 1;
+        lcsDP[i][j].lcs = getLcsAt(i, j) + 1;
         lcsDP[i][j].prevIndex = {i - 1, j - 1};
       } else {
-        if (lcsDP[i - 1][j].lcs > lcsDP[i][j - 1].lcs) {
-          lcsDP[i][j].lcs = lcsDP[i - 1][j].lcs;
+        if (getLcsAt(i, j + 1) > getLcsAt(i + 1, j)) {
+          lcsDP[i][j].lcs = getLcsAt(i, j + 1);
           lcsDP[i][j].prevIndex = {i - 1, j};
         } else {
-          lcsDP[i][j].lcs = lcsDP[i][j - 1].lcs;
+          lcsDP[i][j].lcs = getLcsAt(i + 1, j);
           lcsDP[i][j].prevIndex = {i, j - 1};
         }
       }
@@ -82,6 +85,911 @@ std::vector<std::pair<size_t, size_t>> getLcs(std::string_view firstWord,
   return getLcsIndexes(lcsDP);
 }
 
+// Fixed set of worker threads that run blocks of one task at a time, the
+// calling thread takes blocks too. A pool of size 1 runs everything inline.
+class ThreadPool {
+ public:
+  explicit ThreadPool(size_t nThreads);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  size_t size() const { return workers_.size() + 1; }
+
+  // runs task(block) for every block in [0, nBlocks), returns when all are done
+  void parallelFor(size_t nBlocks, const std::function<void(size_t)>& task);
+
+ private:
+  void runBlocks();
+  void workerLoop();
+
+  std::vector<std::thread> workers_;
+
+  std::mutex mutex_;
+  std::condition_variable taskReady_;
+  std::condition_variable taskDone_;
+
+  const std::function<void(size_t)>* task_ = nullptr;
+  size_t nBlocks_ = 0;
+  size_t nextBlock_ = 0;
+  size_t nFinishedBlocks_ = 0;
+  uint64_t generation_ = 0;
+  bool isStopping_ = false;
+};
+
+ThreadPool::ThreadPool(size_t nThreads) {
+  for (size_t i = 1; i < nThreads; ++i) {
+    workers_.emplace_back([this] { workerLoop(); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    isStopping_ = true;
+  }
+  taskReady_.notify_all();
+
+  for (std::thread& worker : workers_) {
+    worker.join();
+  }
+}
+
+void ThreadPool::parallelFor(size_t nBlocks,
+                             const std::function<void(size_t)>& task) {
+  if (nBlocks == 0) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    task_ = &task;
+    nBlocks_ = nBlocks;
+    nextBlock_ = 0;
+    nFinishedBlocks_ = 0;
+    ++generation_;
+  }
+  taskReady_.notify_all();
+
+  runBlocks();
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  taskDone_.wait(lock, [this] { return nFinishedBlocks_ == nBlocks_; });
+  task_ = nullptr;
+}
+
+void ThreadPool::runBlocks() {
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  while (task_ != nullptr && nextBlock_ < nBlocks_) {
+    size_t block = nextBlock_++;
+    const std::function<void(size_t)>* task = task_;
+
+    lock.unlock();
+    (*task)(block);
+    lock.lock();
+
+    if (++nFinishedBlocks_ == nBlocks_) {
+      taskDone_.notify_all();
+    }
+  }
+}
+
+void ThreadPool::workerLoop() {
+  uint64_t seenGeneration = 0;
+
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      taskReady_.wait(lock, [&] {
+        return isStopping_ || generation_ != seenGeneration;
+      });
+
+      if (isStopping_) {
+        return;
+      }
+      seenGeneration = generation_;
+    }
+
+    runBlocks();
+  }
+}
+
+// Back-pointers of getLcsFullTable as one of three directions, two bits per
+// cell instead of the 12 bytes of IthLcsInfo.
+class PackedLcsDirections {
+ public:
+  enum Direction : uint64_t { Diagonal = 0, Up = 1, Left = 2 };
+
+  PackedLcsDirections(size_t nRows, size_t nColumns)
+      : nRows_(nRows),
+        nColumns_(nColumns),
+        bits_((nRows * nColumns + CellsPerWord - 1) / CellsPerWord, 0) {}
+
+  size_t nRows() const { return nRows_; }
+  size_t nColumns() const { return nColumns_; }
+
+  Direction get(size_t i, size_t j) const {
+    size_t cell = i * nColumns_ + j;
+    return static_cast<Direction>(
+        (bits_[cell / CellsPerWord] >> (2 * (cell % CellsPerWord))) & 3);
+  }
+
+  // every cell is set once
+  void set(size_t i, size_t j, Direction direction) {
+    size_t cell = i * nColumns_ + j;
+    bits_[cell / CellsPerWord] |= direction << (2 * (cell % CellsPerWord));
+  }
+
+ private:
+  static const size_t CellsPerWord = 32;
+
+  size_t nRows_;
+  size_t nColumns_;
+  std::vector<uint64_t> bits_;
+};
+
+// the decisions of getLcsFullTable with two rows of lengths
+PackedLcsDirections computePackedLcsDirections(std::string_view firstWord,
+                                               std::string_view secondWord) {
+  PackedLcsDirections directions(firstWord.size(), secondWord.size());
+
+  // prev[j + 1] = lcs[i - 1][j], cur[j + 1] = lcs[i][j]
+  std::vector<int> prev(secondWord.size() + 1, 0), cur(prev.size(), 0);
+  for (size_t i = 0; i < firstWord.size(); ++i) {
+    for (size_t j = 0; j < secondWord.size(); ++j) {
+      if (firstWord[i] == secondWord[j]) {
+        cur[j + 1] = prev[j] + 1;
+        directions.set(i, j, PackedLcsDirections::Diagonal);
+      } else if (prev[j + 1] > cur[j]) {
+        cur[j + 1] = prev[j + 1];
+        directions.set(i, j, PackedLcsDirections::Up);
+      } else {
+        cur[j + 1] = cur[j];
+        directions.set(i, j, PackedLcsDirections::Left);
+      }
+    }
+
+    std::swap(prev, cur);
+  }
+
+  return directions;
+}
+
+std::vector<std::pair<size_t, size_t>> getLcsIndexes(
+    const PackedLcsDirections& directions) {
+  std::vector<std::pair<size_t, size_t>> indexes;
+
+  int i = directions.nRows() - 1;
+  int j = directions.nColumns() - 1;
+  while (i >= 0 && j >= 0) {
+    switch (directions.get(i, j)) {
+      case PackedLcsDirections::Diagonal:
+        indexes.push_back({i, j});
+        --i;
+        --j;
+        break;
+      case PackedLcsDirections::Up:
+        --i;
+        break;
+      case PackedLcsDirections::Left:
+        --j;
+        break;
+    }
+  }
+
+  std::reverse(indexes.begin(), indexes.end());
+
+  return indexes;
+}
+
+// Rows of the LCS table as bit vectors over the second word: bit j of row i
+// is set when lcs[i][j] = lcs[i][j - 1] + 1, which is the only other option
+// besides equality. One row step is the bit-parallel recurrence of
+// Allison-Dix and Hyyro on V = ~row and the match mask M of the symbol:
+//   V' = (V + (V & M)) | (V & ~M),
+// a few word operations per 64 cells, with the carry of the addition running
+// through all words. Bits above the used width hold garbage, carries only go
+// up, so they never reach the used ones.
+class BitParallelLcsRows {
+ public:
+  using Row = std::vector<uint64_t>;
+
+  explicit BitParallelLcsRows(std::string_view secondWord);
+
+  static size_t getWordCount(size_t width) { return (width + 63) / 64; }
+
+  // Row i - 1 to row i for symbol = firstWord[i] over the words
+  // [wordBegin, wordEnd), carry comes from the words below wordBegin. Returns
+  // the carry out of the last word.
+  uint64_t advance(char symbol, uint64_t* row, size_t wordBegin,
+                   size_t wordEnd, uint64_t carry) const;
+
+  // Rows [rowBegin, rowEnd) of firstWord applied to row over its first nWords
+  // words, see advanceRowsInTiles.
+  void advanceRows(std::string_view firstWord, size_t rowBegin, size_t rowEnd,
+                   uint64_t* row, size_t nWords, ThreadPool& threadPool,
+                   const std::function<void(size_t, size_t, size_t)>& onRow =
+                       nullptr) const;
+
+ private:
+  // by unsigned symbol, empty for the symbols absent from the second word
+  std::vector<Row> matchMasks_;
+  Row zeroMask_;
+};
+
+BitParallelLcsRows::BitParallelLcsRows(std::string_view secondWord)
+    : matchMasks_(256), zeroMask_(getWordCount(secondWord.size()), 0) {
+  for (size_t j = 0; j < secondWord.size(); ++j) {
+    Row& mask = matchMasks_[static_cast<unsigned char>(secondWord[j])];
+    if (mask.empty()) {
+      mask = zeroMask_;
+    }
+
+    mask[j / 64] |= uint64_t{1} << (j % 64);
+  }
+}
+
+uint64_t BitParallelLcsRows::advance(char symbol, uint64_t* row,
+                                     size_t wordBegin, size_t wordEnd,
+                                     uint64_t carry) const {
+  const Row& maskRow = matchMasks_[static_cast<unsigned char>(symbol)];
+  const uint64_t* mask = maskRow.empty() ? zeroMask_.data() : maskRow.data();
+
+  // in terms of the set bits u = ~V: u' = ~(V + (V & M)) & (u | M)
+  size_t w = wordBegin;
+
+#ifdef __AVX2__
+  // Four words at once. The carries between them follow from the lanes that
+  // overflowed (generate) and the lanes that are all ones (propagate), as in
+  // a 4-bit carry-lookahead adder: carries = ((G << 1 | carry) + P) ^ P.
+  static const __m256i laneCarries[16] = {
+#define LANES(c) \
+  _mm256_setr_epi64x((c) & 1, (c) >> 1 & 1, (c) >> 2 & 1, (c) >> 3 & 1)
+      LANES(0),  LANES(1),  LANES(2),  LANES(3),  LANES(4),  LANES(5),
+      LANES(6),  LANES(7),  LANES(8),  LANES(9),  LANES(10), LANES(11),
+      LANES(12), LANES(13), LANES(14), LANES(15)};
+#undef LANES
+  const __m256i ones = _mm256_set1_epi64x(-1);
+  const __m256i signBits = _mm256_set1_epi64x(INT64_MIN);
+
+  for (; w + 4 <= wordEnd; w += 4) {
+    __m256i u = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(row + w));
+    __m256i m = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(mask + w));
+
+    __m256i v = _mm256_xor_si256(u, ones);
+    __m256i sum = _mm256_add_epi64(v, _mm256_and_si256(v, m));
+
+    __m256i overflowed = _mm256_cmpgt_epi64(_mm256_xor_si256(v, signBits),
+                                            _mm256_xor_si256(sum, signBits));
+    __m256i allOnes = _mm256_cmpeq_epi64(sum, ones);
+    uint32_t generate = _mm256_movemask_pd(_mm256_castsi256_pd(overflowed));
+    uint32_t propagate = _mm256_movemask_pd(_mm256_castsi256_pd(allOnes));
+
+    uint32_t carries = ((generate << 1 | carry) + propagate) ^ propagate;
+    carry = carries >> 4;
+    sum = _mm256_add_epi64(sum, laneCarries[carries & 15]);
+
+    __m256i res = _mm256_andnot_si256(sum, _mm256_or_si256(u, m));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(row + w), res);
+  }
+#endif
+
+  for (; w < wordEnd; ++w) {
+    uint64_t v = ~row[w];
+    uint64_t sum = v + (v & mask[w]);
+    uint64_t overflowed = sum < v;
+    sum += carry;
+    carry = overflowed | (sum < carry);
+
+    row[w] = ~sum & (row[w] | mask[w]);
+  }
+
+  return carry;
+}
+
+const size_t LcsTileRows = 256;
+const size_t LcsTileWords = 64;
+
+// The rows go in tiles of LcsTileRows rows by LcsTileWords words. A tile needs
+// the tile above, whose last row it continues in place, and the tile to the
+// left, for the carries into its rows, so the tiles of one anti-diagonal are
+// independent and run in parallel. Only the row and one carry per row are
+// kept. onRow(i, wordBegin, wordEnd) is called as soon as row i is final over
+// those words, row holds it there.
+void BitParallelLcsRows::advanceRows(
+    std::string_view firstWord, size_t rowBegin, size_t rowEnd, uint64_t* row,
+    size_t nWords, ThreadPool& threadPool,
+    const std::function<void(size_t, size_t, size_t)>& onRow) const {
+  if (rowBegin == rowEnd || nWords == 0) {
+    return;
+  }
+
+  const size_t nBands = (rowEnd - rowBegin + LcsTileRows - 1) / LcsTileRows;
+  const size_t nChunks = (nWords + LcsTileWords - 1) / LcsTileWords;
+  std::vector<uint8_t> carries(rowEnd - rowBegin, 0);
+
+  auto advanceTile = [&](size_t band, size_t chunk) {
+    const size_t bandBegin = rowBegin + band * LcsTileRows;
+    const size_t bandEnd = std::min(rowEnd, bandBegin + LcsTileRows);
+    const size_t wordBegin = chunk * LcsTileWords;
+    const size_t wordEnd = std::min(nWords, wordBegin + LcsTileWords);
+
+    for (size_t i = bandBegin; i < bandEnd; ++i) {
+      uint8_t& carry = carries[i - rowBegin];
+      carry = advance(firstWord[i], row, wordBegin, wordEnd, carry);
+
+      if (onRow) {
+        onRow(i, wordBegin, wordEnd);
+      }
+    }
+  };
+
+  for (size_t diagonal = 0; diagonal < nBands + nChunks - 1; ++diagonal) {
+    const size_t firstBand = diagonal < nChunks ? 0 : diagonal - nChunks + 1;
+    const size_t lastBand = std::min(diagonal, nBands - 1);
+
+    threadPool.parallelFor(lastBand - firstBand + 1, [&](size_t k) {
+      size_t band = firstBand + k;
+      advanceTile(band, diagonal - band);
+    });
+  }
+}
+
+// LCS length only, O(n * m / 64) time and O(n + m) memory
+size_t getLcsLength(std::string_view firstWord, std::string_view secondWord,
+                    size_t nThreads = 1) {
+  BitParallelLcsRows rows(secondWord);
+  ThreadPool threadPool(nThreads);
+
+  const size_t nWords = BitParallelLcsRows::getWordCount(secondWord.size());
+  BitParallelLcsRows::Row row(nWords, 0);
+  rows.advanceRows(firstWord, 0, firstWord.size(), row.data(), nWords,
+                   threadPool);
+
+  size_t length = 0;
+  for (size_t w = 0; w < nWords; ++w) {
+    uint64_t word = row[w];
+    if (w == nWords - 1 && secondWord.size() % 64 != 0) {
+      word &= (uint64_t{1} << (secondWord.size() % 64)) - 1;
+    }
+
+    length += __builtin_popcountll(word);
+  }
+
+  return length;
+}
+
+// Traceback of getLcsFullTable in O(n + m) memory. The rows are split into
+// blocks, a forward pass stores the rows above the blocks, and the traceback
+// goes through the blocks from the last one up, each either recursively or
+// with all of its rows once they fit the memory budget. The path decisions
+// only depend on the cells above and to the left, so they match the full
+// table exactly.
+class LinearSpaceLcs {
+ public:
+  LinearSpaceLcs(std::string_view firstWord, std::string_view secondWord,
+                 size_t memoryBudget, ThreadPool& threadPool);
+
+  std::vector<std::pair<size_t, size_t>> getLcsIndexes();
+
+ private:
+  using Row = BitParallelLcsRows::Row;
+
+  // Continues the traceback from (rowEnd - 1, lastColumn) until it leaves the
+  // rows [rowBegin, rowEnd) with topRow the row above them. Returns the column
+  // the path enters row rowBegin - 1 at, -1 once the path is over.
+  int traceRows(size_t rowBegin, size_t rowEnd, int lastColumn,
+                const Row& topRow);
+  int traceRowsWithTable(size_t rowBegin, size_t rowEnd, int lastColumn,
+                         const Row& topRow);
+
+  std::string_view firstWord_;
+  std::string_view secondWord_;
+  size_t memoryBudget_;
+  ThreadPool& threadPool_;
+  BitParallelLcsRows rows_;
+  std::vector<uint64_t> tableBuffer_;
+  // found from the end of the words
+  std::vector<std::pair<size_t, size_t>> reversedIndexes_;
+};
+
+LinearSpaceLcs::LinearSpaceLcs(std::string_view firstWord,
+                               std::string_view secondWord,
+                               size_t memoryBudget, ThreadPool& threadPool)
+    : firstWord_(firstWord),
+      secondWord_(secondWord),
+      memoryBudget_(memoryBudget),
+      threadPool_(threadPool),
+      rows_(secondWord) {}
+
+int LinearSpaceLcs::traceRows(size_t rowBegin, size_t rowEnd, int lastColumn,
+                              const Row& topRow) {
+  const size_t nRows = rowEnd - rowBegin;
+  const size_t nWords = BitParallelLcsRows::getWordCount(lastColumn + 1);
+  const size_t rowBytes = nWords * sizeof(uint64_t);
+
+  if (nRows == 1 || nRows * rowBytes <= memoryBudget_) {
+    return traceRowsWithTable(rowBegin, rowEnd, lastColumn, topRow);
+  }
+
+  // blocks whose rows take about half of the budget, so that they are traced
+  // with a table right away
+  const size_t halfBudget = std::max(memoryBudget_ / 2, rowBytes);
+  const size_t nBlocks = std::clamp<size_t>(
+      (nRows * rowBytes + halfBudget - 1) / halfBudget, 2, nRows);
+  auto getBlockBegin = [&](size_t block) {
+    return rowBegin + nRows * block / nBlocks;
+  };
+
+  // rows above every block but the first one
+  std::vector<Row> blockTopRows(nBlocks, Row(nWords));
+  Row row(topRow.begin(), topRow.begin() + nWords);
+  rows_.advanceRows(
+      firstWord_, rowBegin, getBlockBegin(nBlocks - 1), row.data(), nWords,
+      threadPool_, [&](size_t i, size_t wordBegin, size_t wordEnd) {
+        size_t block = ((i + 1 - rowBegin) * nBlocks + nRows - 1) / nRows;
+        if (getBlockBegin(block) == i + 1) {
+          std::copy(row.begin() + wordBegin, row.begin() + wordEnd,
+                    blockTopRows[block].begin() + wordBegin);
+        }
+      });
+
+  int column = lastColumn;
+  for (size_t block = nBlocks; block-- > 0 && column >= 0;) {
+    const Row& blockTopRow = block == 0 ? topRow : blockTopRows[block];
+    column = traceRows(getBlockBegin(block), getBlockBegin(block + 1), column,
+                       blockTopRow);
+    blockTopRows[block].clear();
+  }
+
+  return column;
+}
+
+int LinearSpaceLcs::traceRowsWithTable(size_t rowBegin, size_t rowEnd,
+                                       int lastColumn, const Row& topRow) {
+  const size_t nWords = BitParallelLcsRows::getWordCount(lastColumn + 1);
+
+  // table[k] = row rowBegin + k, the buffer is reused by all leaves
+  std::vector<uint64_t>& table = tableBuffer_;
+  if (table.size() < (rowEnd - rowBegin) * nWords) {
+    table.resize((rowEnd - rowBegin) * nWords);
+  }
+  Row row(topRow.begin(), topRow.begin() + nWords);
+  rows_.advanceRows(firstWord_, rowBegin, rowEnd, row.data(), nWords,
+                    threadPool_,
+                    [&](size_t i, size_t wordBegin, size_t wordEnd) {
+                      std::copy(row.begin() + wordBegin, row.begin() + wordEnd,
+                                &table[(i - rowBegin) * nWords + wordBegin]);
+                    });
+
+  // Away from a match lcs[i][j] = max(lcs[i - 1][j], lcs[i][j - 1]), so the
+  // cell above is strictly longer than the left one exactly when the left one
+  // is shorter than the cell itself: the bit of the cell.
+  size_t i = rowEnd;
+  int j = lastColumn;
+  while (i-- > rowBegin && j >= 0) {
+    const uint64_t* row = &table[(i - rowBegin) * nWords];
+
+    while (j >= 0 && firstWord_[i] != secondWord_[j] &&
+           ((row[j / 64] >> (j % 64)) & 1) == 0) {
+      --j;
+    }
+
+    if (j >= 0 && firstWord_[i] == secondWord_[j]) {
+      reversedIndexes_.push_back({i, j});
+      --j;
+    }
+  }
+
+  return j;
+}
+
+std::vector<std::pair<size_t, size_t>> LinearSpaceLcs::getLcsIndexes() {
+  reversedIndexes_.clear();
+
+  if (!firstWord_.empty() && !secondWord_.empty()) {
+    Row zeroRow(BitParallelLcsRows::getWordCount(secondWord_.size()), 0);
+    traceRows(0, firstWord_.size(), secondWord_.size() - 1, zeroRow);
+  }
+
+  return {reversedIndexes_.rbegin(), reversedIndexes_.rend()};
+}
+
+// Hunt-Szymanski over the r matching pairs, O((r + n) log n) time and O(r)
+// memory. thresholds[k] after row i is the first column j with
+// lcs[i][j] > k, a row is updated from its matches in decreasing column order
+// by binary search. Every change is logged, so the rows come back in reverse
+// order for the traceback: column j is a threshold of row i exactly when
+// lcs[i][j] > lcs[i][j - 1], which is when the canonical path goes up, so
+// from (i, j) the path takes the last match or threshold of row i at or
+// before j.
+std::vector<std::pair<size_t, size_t>> getLcsSparse(
+    std::string_view firstWord, std::string_view secondWord) {
+  std::vector<std::vector<int>> occurrences(256);
+  for (size_t j = 0; j < secondWord.size(); ++j) {
+    occurrences[static_cast<unsigned char>(secondWord[j])].push_back(j);
+  }
+  auto getOccurrences = [&](char symbol) -> const std::vector<int>& {
+    return occurrences[static_cast<unsigned char>(symbol)];
+  };
+
+  struct ThresholdChange {
+    int k;
+    // NoThreshold when the change appended thresholds[k]
+    int prevColumn;
+  };
+  const int NoThreshold = -1;
+
+  std::vector<int> thresholds;
+  std::vector<ThresholdChange> changes;
+  // changes of row i are [rowChangesEnd[i - 1], rowChangesEnd[i])
+  std::vector<size_t> rowChangesEnd(firstWord.size());
+
+  for (size_t i = 0; i < firstWord.size(); ++i) {
+    const std::vector<int>& columns = getOccurrences(firstWord[i]);
+
+    for (auto it = columns.rbegin(); it != columns.rend(); ++it) {
+      auto pos = std::lower_bound(thresholds.begin(), thresholds.end(), *it);
+      int k = pos - thresholds.begin();
+
+      if (pos == thresholds.end()) {
+        changes.push_back({k, NoThreshold});
+        thresholds.push_back(*it);
+      } else if (*pos != *it) {
+        changes.push_back({k, *pos});
+        *pos = *it;
+      }
+    }
+
+    rowChangesEnd[i] = changes.size();
+  }
+
+  std::vector<std::pair<size_t, size_t>> indexes;
+  indexes.reserve(thresholds.size());
+
+  int j = secondWord.size() - 1;
+  for (size_t i = firstWord.size(); i-- > 0 && j >= 0;) {
+    auto threshold = std::upper_bound(thresholds.begin(), thresholds.end(), j);
+    int lastThreshold =
+        threshold == thresholds.begin() ? -1 : *std::prev(threshold);
+
+    const std::vector<int>& columns = getOccurrences(firstWord[i]);
+    auto match = std::upper_bound(columns.begin(), columns.end(), j);
+    int lastMatch = match == columns.begin() ? -1 : *std::prev(match);
+
+    if (lastMatch >= 0 && lastMatch >= lastThreshold) {
+      indexes.push_back({i, lastMatch});
+      j = lastMatch - 1;
+    } else {
+      j = lastThreshold;
+    }
+
+    size_t rowChangesBegin = i == 0 ? 0 : rowChangesEnd[i - 1];
+    for (size_t c = rowChangesEnd[i]; c-- > rowChangesBegin;) {
+      if (changes[c].prevColumn == NoThreshold) {
+        thresholds.pop_back();
+      } else {
+        thresholds[changes[c].k] = changes[c].prevColumn;
+      }
+    }
+  }
+
+  std::reverse(indexes.begin(), indexes.end());
+
+  return indexes;
+}
+
+// Myers' greedy O((n + m) D) search for the number D of insertions and
+// deletions between the words, furthest[k] is the furthest point of the
+// first word reached on the diagonal j - i = -k. Gives up with
+// maxEditDistance + 1 once D is known to be bigger.
+size_t findEditDistance(std::string_view firstWord, std::string_view secondWord,
+                        size_t maxEditDistance) {
+  const int n = firstWord.size(), m = secondWord.size();
+  const int maxD = std::min<size_t>(maxEditDistance, n + m);
+
+  std::vector<int> furthest(2 * maxD + 3, 0);
+  auto at = [&](int k) -> int& { return furthest[k + maxD + 1]; };
+
+  for (int d = 0; d <= maxD; ++d) {
+    for (int k = -d; k <= d; k += 2) {
+      int i = k == -d || (k != d && at(k - 1) < at(k + 1)) ? at(k + 1)
+                                                          : at(k - 1) + 1;
+      int j = i - k;
+      while (i < n && j < m && firstWord[i] == secondWord[j]) {
+        ++i;
+        ++j;
+      }
+
+      at(k) = i;
+      if (i >= n && j >= m) {
+        return d;
+      }
+    }
+  }
+
+  return maxEditDistance + 1;
+}
+
+// Traceback of getLcsFullTable over the cells with |j - i| <= bandRadius
+// only. Whenever the canonical path passes (i, j), the prefixes up to it are
+// aligned optimally, so with D = n + m - 2 lcs edits the path keeps within
+// |j - i| <= D, and lcs[i][j - 1] is needed only when it is at most one below
+// lcs[i][j], which makes its optimal prefix alignment take at most D + 1
+// edits. A band of radius D + 1 therefore has the exact values of every cell
+// the traceback looks at. Rows of the band are computed in blocks whose up
+// or left bits (see BitParallelLcsRows) fit half of the memory budget, from
+// stored rows of values above the blocks.
+std::vector<std::pair<size_t, size_t>> getLcsInBand(
+    std::string_view firstWord, std::string_view secondWord,
+    size_t bandRadius, size_t memoryBudget) {
+  const int n = firstWord.size(), m = secondWord.size();
+  const int radius = bandRadius;
+  const int width = 2 * radius + 1;
+  const int NotReached = -n - m - 1;
+
+  // row[t] = lcs[i][i - radius + t], out of the band or the words it is
+  // NotReached, column -1 is 0
+  auto computeRow = [&](int i, const std::vector<int>& prev,
+                        std::vector<int>& cur, uint64_t* isUpBits) {
+    // the columns of the words are t in [tBegin, tEnd)
+    const int tBegin = std::max(0, radius - i);
+    const int tEnd = std::min(width, m + radius - i);
+
+    std::fill(cur.begin(), cur.end(), NotReached);
+    if (tBegin > 0) {
+      cur[tBegin - 1] = 0;
+    }
+
+    const char symbol = firstWord[i];
+    int left = tBegin > 0 ? 0 : NotReached;
+    for (int t = tBegin; t < tEnd; ++t) {
+      int up = t + 1 < width ? prev[t + 1] : NotReached;
+      int value =
+          symbol == secondWord[i - radius + t] ? prev[t] + 1
+                                               : std::max(up, left);
+
+      if (isUpBits != nullptr && value > left) {
+        isUpBits[t / 64] |= uint64_t{1} << (t % 64);
+      }
+
+      cur[t] = value;
+      left = value;
+    }
+  };
+
+  const size_t wordsPerRow = (width + 63) / 64;
+  const size_t blockRows = std::clamp<size_t>(
+      memoryBudget / 2 / (wordsPerRow * sizeof(uint64_t)), 1, n);
+  const size_t nBlocks = (n + blockRows - 1) / blockRows;
+
+  // rows above every block, row -1 is all zeros
+  std::vector<std::vector<int>> blockTopRows(nBlocks);
+  std::vector<int> prev(width, 0), cur(width);
+  for (int i = 0; i < n; ++i) {
+    if (i % blockRows == 0) {
+      blockTopRows[i / blockRows] = prev;
+    }
+
+    computeRow(i, prev, cur, nullptr);
+    std::swap(prev, cur);
+  }
+
+  std::vector<std::pair<size_t, size_t>> indexes;
+  std::vector<uint64_t> isUpBits;
+
+  int i = n - 1, j = m - 1;
+  for (size_t block = nBlocks; block-- > 0 && i >= 0 && j >= 0;) {
+    const int blockBegin = block * blockRows;
+
+    isUpBits.assign((i - blockBegin + 1) * wordsPerRow, 0);
+    prev = blockTopRows[block];
+    for (int row = blockBegin; row <= i; ++row) {
+      computeRow(row, prev, cur, &isUpBits[(row - blockBegin) * wordsPerRow]);
+      std::swap(prev, cur);
+    }
+    blockTopRows[block].clear();
+
+    while (i >= blockBegin && j >= 0) {
+      int t = j - i + radius;
+      assert(0 <= t && t < width);
+
+      if (firstWord[i] == secondWord[j]) {
+        indexes.push_back({i, j});
+        --i;
+        --j;
+      } else if ((isUpBits[(i - blockBegin) * wordsPerRow + t / 64] >>
+                  (t % 64)) & 1) {
+        --i;
+      } else {
+        --j;
+      }
+    }
+  }
+
+  std::reverse(indexes.begin(), indexes.end());
+
+  return indexes;
+}
+
+// banded traceback when the words are at most maxEditDistance insertions and
+// deletions apart, nothing otherwise
+std::optional<std::vector<std::pair<size_t, size_t>>> getLcsForCloseWords(
+    std::string_view firstWord, std::string_view secondWord,
+    size_t maxEditDistance, size_t memoryBudget) {
+  size_t editDistance =
+      findEditDistance(firstWord, secondWord, maxEditDistance);
+  if (editDistance > maxEditDistance) {
+    return std::nullopt;
+  }
+
+  return getLcsInBand(firstWord, secondWord, editDistance + 1, memoryBudget);
+}
+
+// number of matching pairs (i, j), from the symbol histograms
+size_t countMatchingPairs(std::string_view firstWord,
+                          std::string_view secondWord) {
+  std::vector<size_t> firstCounts(256, 0), secondCounts(256, 0);
+  for (char symbol : firstWord) {
+    ++firstCounts[static_cast<unsigned char>(symbol)];
+  }
+  for (char symbol : secondWord) {
+    ++secondCounts[static_cast<unsigned char>(symbol)];
+  }
+
+  size_t nPairs = 0;
+  for (size_t symbol = 0; symbol < 256; ++symbol) {
+    nPairs += firstCounts[symbol] * secondCounts[symbol];
+  }
+
+  return nPairs;
+}
+
+enum class LcsEngine {
+  // by the sizes of the words and the number of matching pairs
+  Auto,
+  FullTable,
+  // PackedLcsDirections, not picked by Auto: the bit-parallel engine keeps
+  // one bit per cell when the whole table fits and is much faster
+  PackedTable,
+  BitParallel,
+  SparseMatches,
+  // the banded engine for words a few edits apart, falls back to Auto
+  CloseWords,
+};
+
+struct LcsConfig {
+  // bytes the table of getLcsFullTable or the change log of getLcsSparse may
+  // take, LinearSpaceLcs stays within about this much memory
+  size_t memoryBudget = size_t{1} << 28;
+  // print only the length, found by getLcsLength
+  bool isLengthOnly = false;
+  // threads of the bit-parallel passes
+  size_t nThreads = 1;
+  LcsEngine engine = LcsEngine::Auto;
+  // edits between the words up to which CloseWords takes them, 0 to derive
+  // it from the word sizes
+  size_t maxEditDistance = 0;
+};
+
+// The band costs a few operations per cell on 2 D + 3 diagonals, about as
+// much as a word step of the bit-parallel engine for D near m / 64, and the
+// search for D costs (n + m) D / 2 steps at most.
+size_t getMaxEditDistance(std::string_view firstWord,
+                          std::string_view secondWord,
+                          const LcsConfig& config) {
+  if (config.maxEditDistance != 0) {
+    return config.maxEditDistance;
+  }
+
+  return std::min(firstWord.size(), secondWord.size()) / 256;
+}
+
+// Hunt-Szymanski does a binary search and keeps a log entry per matching
+// pair, the bit-parallel engine does about two passes of a few word
+// operations per 64 cells. Measured, a pair costs about as much as two word
+// steps per binary search step.
+LcsEngine chooseLcsEngine(std::string_view firstWord,
+                          std::string_view secondWord,
+                          const LcsConfig& config) {
+  const size_t nMatchingPairs = countMatchingPairs(firstWord, secondWord);
+  const size_t nWordSteps =
+      firstWord.size() * ((secondWord.size() + 63) / 64);
+  const size_t searchSteps = std::bit_width(secondWord.size());
+
+  if (nMatchingPairs * searchSteps * 2 <= nWordSteps &&
+      nMatchingPairs * 2 * sizeof(int) <= config.memoryBudget) {
+    return LcsEngine::SparseMatches;
+  }
+
+  if (firstWord.size() * secondWord.size() * sizeof(IthLcsInfo) <=
+      config.memoryBudget) {
+    return LcsEngine::FullTable;
+  }
+
+  return LcsEngine::BitParallel;
+}
+
+std::vector<std::pair<size_t, size_t>> getLcs(std::string_view firstWord,
+                                              std::string_view secondWord,
+                                              const LcsConfig& config = {}) {
+  if (firstWord.empty() || secondWord.empty()) {
+    return {};
+  }
+
+  if (config.engine == LcsEngine::Auto ||
+      config.engine == LcsEngine::CloseWords) {
+    auto indexes = getLcsForCloseWords(
+        firstWord, secondWord,
+        getMaxEditDistance(firstWord, secondWord, config), config.memoryBudget);
+    if (indexes) {
+      return *indexes;
+    }
+  }
+
+  LcsEngine engine = config.engine == LcsEngine::Auto ||
+                             config.engine == LcsEngine::CloseWords
+                         ? chooseLcsEngine(firstWord, secondWord, config)
+                         : config.engine;
+
+  if (engine == LcsEngine::FullTable) {
+    return getLcsFullTable(firstWord, secondWord);
+  }
+  if (engine == LcsEngine::PackedTable) {
+    return getLcsIndexes(computePackedLcsDirections(firstWord, secondWord));
+  }
+  if (engine == LcsEngine::SparseMatches) {
+    return getLcsSparse(firstWord, secondWord);
+  }
+
+  ThreadPool threadPool(config.nThreads);
+
+  return LinearSpaceLcs(firstWord, secondWord, config.memoryBudget, threadPool)
+      .getLcsIndexes();
+}
+
+// std::nullopt on an unknown option or engine
+std::optional<LcsConfig> parseLcsConfig(int argc, char* argv[]) {
+  LcsConfig config;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string_view option = argv[i];
+
+    if (option == "--memory-budget" && i + 1 < argc) {
+      config.memoryBudget = std::stoull(argv[++i]);
+    } else if (option == "--threads" && i + 1 < argc) {
+      config.nThreads = std::max<size_t>(1, std::stoul(argv[++i]));
+    } else if (option == "--max-edits" && i + 1 < argc) {
+      config.maxEditDistance = std::stoull(argv[++i]);
+    } else if (option == "--length-only") {
+      config.isLengthOnly = true;
+    } else if (option == "--engine" && i + 1 < argc) {
+      std::string_view engine = argv[++i];
+      if (engine == "table") {
+        config.engine = LcsEngine::FullTable;
+      } else if (engine == "packed") {
+        config.engine = LcsEngine::PackedTable;
+      } else if (engine == "bit-parallel") {
+        config.engine = LcsEngine::BitParallel;
+      } else if (engine == "sparse") {
+        config.engine = LcsEngine::SparseMatches;
+      } else if (engine == "close") {
+        config.engine = LcsEngine::CloseWords;
+      } else {
+        std::cerr << "Unknown engine " << engine << "\n";
+        return std::nullopt;
+      }
+    } else {
+      std::cerr << "Unknown option " << option << "\n";
+      return std::nullopt;
+    }
+  }
+
+  return config;
+}
+
 void printLcs(const std::vector<std::pair<size_t, size_t>>& lcsIndexes) {
   std::cout << lcsIndexes.size() << "\n";
 
@@ -94,12 +1002,24 @@ void printLcs(const std::vector<std::pair<size_t, size_t>>& lcsIndexes) {
     std::cout << lcsIndexes[i].second + 1 << " ";
 }
 
-int main() {
+int main(int argc, char* argv[]) {
+  std::optional<LcsConfig> parsedConfig = parseLcsConfig(argc, argv);
+  if (!parsedConfig) {
+    return 1;
+  }
+  const LcsConfig& config = *parsedConfig;
+
   std::string firstWord, secondWord;
 
   std::cin >> firstWord >> secondWord;
 
-  auto lcsIndexes = getLcs(firstWord, secondWord);
+  if (config.isLengthOnly) {
+    std::cout << getLcsLength(firstWord, secondWord, config.nThreads)
+              << "\n";
+    return 0;
+  }
+
+  auto lcsIndexes = getLcs(firstWord, secondWord, config);
 
   printLcs(lcsIndexes);
 }
@@ -1,27 +1,122 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
 #include <cassert>
+#include <cmath>
+#include <condition_variable>
 #include <cstdint>
+#include <functional>
 #include <iostream>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
 #include <vector>
 
+const size_t MaxMaskBits = sizeof(uint64_t) * __CHAR_BIT__;
+const size_t MaxRobots = 256;
+
+// Set of vertexes of a graph with at most MaxRobots vertexes
+class VertexSet {
+  std::array<uint64_t, MaxRobots / MaxMaskBits> words_{};
+
+ public:
+  void insert(size_t vertex);
+
+  void erase(size_t vertex);
+
+  bool contains(size_t vertex) const;
+
+  bool empty() const;
+
+  size_t count() const;
+
+  // the smallest vertex, the set must not be empty
+  size_t front() const;
+
+  uint64_t getWord(size_t index) const;
+
+  VertexSet operator&(const VertexSet& other) const;
+
+  // vertexes of this set that are not in other
+  VertexSet without(const VertexSet& other) const;
+};
+
+void VertexSet::insert(size_t vertex) {
+  words_[vertex / MaxMaskBits] |= uint64_t{1} << (vertex % MaxMaskBits);
+}
+
+void VertexSet::erase(size_t vertex) {
+  words_[vertex / MaxMaskBits] &= ~(uint64_t{1} << (vertex % MaxMaskBits));
+}
+
+bool VertexSet::contains(size_t vertex) const {
+  return (words_[vertex / MaxMaskBits] >> (vertex % MaxMaskBits)) & 1;
+}
+
+bool VertexSet::empty() const {
+  return std::all_of(words_.begin(), words_.end(),
+                     [](uint64_t word) { return word == 0; });
+}
+
+size_t VertexSet::count() const {
+  size_t count = 0;
+  for (uint64_t word : words_) {
+    count += std::popcount(word);
+  }
+  return count;
+}
+
+size_t VertexSet::front() const {
+  size_t index = 0;
+  while (words_[index] == 0) {
+    ++index;
+  }
+  return index * MaxMaskBits + std::countr_zero(words_[index]);
+}
+
+uint64_t VertexSet::getWord(size_t index) const { return words_[index]; }
+
+VertexSet VertexSet::operator&(const VertexSet& other) const {
+  VertexSet result;
+  for (size_t i = 0; i < words_.size(); ++i) {
+    result.words_[i] = words_[i] & other.words_[i];
+  }
+  return result;
+}
+
+VertexSet VertexSet::without(const VertexSet& other) const {
+  VertexSet result;
+  for (size_t i = 0; i < words_.size(); ++i) {
+    result.words_[i] = words_[i] & ~other.words_[i];
+  }
+  return result;
+}
+
 class Graph {
-  std::vector<uint32_t> edgesMasks_;
+  std::vector<VertexSet> edgesMasks_;
 
  public:
   explicit Graph(const std::vector<std::vector<int> >& graph);
 
-  uint32_t getEdgesMask(size_t vertex) const;
+  // for graphs of at most MaxMaskBits vertexes
+  uint64_t getEdgesMask(size_t vertex) const;
+
+  const VertexSet& getEdgesSet(size_t vertex) const;
 
   size_t size() const;
 };
 
 Graph::Graph(const std::vector<std::vector<int> >& graph) {
   size_t size = graph.size();
+  assert(size <= MaxRobots);
   edgesMasks_.resize(size);
 
   for (size_t i = 0; i < size; ++i) {
     for (size_t j = 0; j < size; ++j) {
       if (graph[i][j]) {
-        edgesMasks_[i] |= (1 << j);
+        edgesMasks_[i].insert(j);
       }
     }
   }
@@ -29,11 +124,189 @@ Graph::Graph(const std::vector<std::vector<int> >& graph) {
 
 size_t Graph::size() const { return edgesMasks_.size(); }
 
-uint32_t Graph::getEdgesMask(size_t vertex) const { return edgesMasks_[vertex]; }
+uint64_t Graph::getEdgesMask(size_t vertex) const {
+  assert(size() <= MaxMaskBits);
+  return edgesMasks_[vertex].getWord(0);
+}
+
+const VertexSet& Graph::getEdgesSet(size_t vertex) const {
+  return edgesMasks_[vertex];
+}
+
+// Bit per mask, packed into words
+class BitArray {
+  std::vector<uint64_t> words_;
+  size_t size_;
+
+ public:
+  explicit BitArray(size_t size);
+
+  bool get(size_t index) const;
+
+  void set(size_t index);
+
+  size_t size() const;
+};
+
+BitArray::BitArray(size_t size)
+    : words_((size + MaxMaskBits - 1) / MaxMaskBits, 0), size_(size) {}
+
+bool BitArray::get(size_t index) const {
+  return (words_[index / MaxMaskBits] >> (index % MaxMaskBits)) & 1;
+}
+
+void BitArray::set(size_t index) {
+  words_[index / MaxMaskBits] |= uint64_t{1} << (index % MaxMaskBits);
+}
+
+size_t BitArray::size() const { return size_; }
+
+// Fixed set of worker threads that run blocks of one task at a time, the
+// calling thread takes blocks too. A pool of size 1 runs everything inline.
+class ThreadPool {
+ public:
+  explicit ThreadPool(size_t nThreads);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  size_t size() const { return workers_.size() + 1; }
+
+  // runs task(block) for every block in [0, nBlocks), returns when all are done
+  void parallelFor(size_t nBlocks, const std::function<void(size_t)>& task);
+
+ private:
+  void runBlocks();
+  void workerLoop();
+
+  std::vector<std::thread> workers_;
+
+  std::mutex mutex_;
+  std::condition_variable taskReady_;
+  std::condition_variable taskDone_;
+
+  const std::function<void(size_t)>* task_ = nullptr;
+  size_t nBlocks_ = 0;
+  size_t nextBlock_ = 0;
+  size_t nFinishedBlocks_ = 0;
+  uint64_t generation_ = 0;
+  bool isStopping_ = false;
+};
+
+ThreadPool::ThreadPool(size_t nThreads) {
+  for (size_t i = 1; i < nThreads; ++i) {
+    workers_.emplace_back([this] { workerLoop(); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    isStopping_ = true;
+  }
+  taskReady_.notify_all();
+
+  for (std::thread& worker : workers_) {
+    worker.join();
+  }
+}
+
+void ThreadPool::parallelFor(size_t nBlocks,
+                             const std::function<void(size_t)>& task) {
+  if (nBlocks == 0) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    task_ = &task;
+    nBlocks_ = nBlocks;
+    nextBlock_ = 0;
+    nFinishedBlocks_ = 0;
+    ++generation_;
+  }
+  taskReady_.notify_all();
+
+  runBlocks();
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  taskDone_.wait(lock, [this] { return nFinishedBlocks_ == nBlocks_; });
+  task_ = nullptr;
+}
+
+void ThreadPool::runBlocks() {
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  while (task_ != nullptr && nextBlock_ < nBlocks_) {
+    size_t block = nextBlock_++;
+    const std::function<void(size_t)>* task = task_;
+
+    lock.unlock();
+    (*task)(block);
+    lock.lock();
+
+    if (++nFinishedBlocks_ == nBlocks_) {
+      taskDone_.notify_all();
+    }
+  }
+}
+
+void ThreadPool::workerLoop() {
+  uint64_t seenGeneration = 0;
+
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      taskReady_.wait(lock, [&] {
+        return isStopping_ || generation_ != seenGeneration;
+      });
+
+      if (isStopping_) {
+        return;
+      }
+      seenGeneration = generation_;
+    }
+
+    runBlocks();
+  }
+}
+
+// Masks of one level that go to a single block. A multiple of the BitArray
+// word so that blocks never share a word
+const uint64_t ParallelMaskBlock = uint64_t{1} << 14;
+
+// Calls fill(mask, maxBitPos) for every mask in [1, nMasks), nMasks being a
+// power of two. Masks with the highest bit maxBitPos depend only on smaller
+// masks, so each level [2^maxBitPos, 2^(maxBitPos + 1)) is derived from the
+// lower half in parallel once that half is done
+template <typename Fill>
+void fillByLevels(uint64_t nMasks, ThreadPool& threadPool, Fill fill) {
+  for (size_t maxBitPos = 0; (uint64_t{1} << maxBitPos) < nMasks;
+       ++maxBitPos) {
+    uint64_t levelBegin = uint64_t{1} << maxBitPos;
+
+    if (threadPool.size() == 1 || levelBegin <= ParallelMaskBlock) {
+      for (uint64_t mask = levelBegin; mask < 2 * levelBegin; ++mask) {
+        fill(mask, maxBitPos);
+      }
+      continue;
+    }
+
+    threadPool.parallelFor(levelBegin / ParallelMaskBlock, [&](size_t block) {
+      uint64_t blockBegin = levelBegin + block * ParallelMaskBlock;
+      for (uint64_t mask = blockBegin; mask < blockBegin + ParallelMaskBlock;
+           ++mask) {
+        fill(mask, maxBitPos);
+      }
+    });
+  }
+}
 
 std::vector<std::vector<int> > readFriendsGraph() {
   size_t numberOfRobots = 0;
   std::cin >> numberOfRobots;
+  assert(numberOfRobots <= MaxRobots);
 
   std::vector<std::vector<int> > friends(numberOfRobots,
                                          std::vector<int>(numberOfRobots));
@@ -54,46 +327,46 @@ std::vector<std::vector<int> > readFriendsGraph() {
   return friends;
 }
 
-std::vector<uint32_t> findFirstToSecondGraphEdges(
+std::vector<uint64_t> findFirstToSecondGraphEdges(
     const std::vector<std::vector<int> >& friends, size_t firstGraphSize,
     size_t secondGraphSize) {
-  assert(secondGraphSize < sizeof(uint32_t) * __CHAR_BIT__);
+  assert(secondGraphSize < MaxMaskBits);
 
-  std::vector<uint32_t> firstToSecondGraphEdges(firstGraphSize);
+  std::vector<uint64_t> firstToSecondGraphEdges(firstGraphSize);
 
   for (size_t i = 0; i < firstGraphSize; ++i) {
     for (size_t j = 0; j < secondGraphSize; ++j) {
       if (friends[i][j + firstGraphSize])
-        firstToSecondGraphEdges[i] |= (1 << j);
+        firstToSecondGraphEdges[i] |= uint64_t{1} << j;
     }
   }
 
   return firstToSecondGraphEdges;
 }
 
-std::vector<uint32_t> findPossibleVertexesInSecondGraph(
+std::vector<uint64_t> findPossibleVertexesInSecondGraph(
     const std::vector<std::vector<int> >& friends, size_t firstGraphSize,
-    size_t secondGraphSize) {
-  std::vector<uint32_t> possibleVertexesInSecondGraph(1 << firstGraphSize, 0);
+    size_t secondGraphSize, ThreadPool& threadPool) {
+  assert(firstGraphSize < MaxMaskBits);
+  std::vector<uint64_t> possibleVertexesInSecondGraph(
+      uint64_t{1} << firstGraphSize, 0);
 
-  std::vector<uint32_t> firstToSecondGraphEdges =
+  std::vector<uint64_t> firstToSecondGraphEdges =
       findFirstToSecondGraphEdges(friends, firstGraphSize, secondGraphSize);
   assert(firstToSecondGraphEdges.size() == firstGraphSize);
 
-  size_t maxBitPos = 0;
-  possibleVertexesInSecondGraph[0] = (1 << secondGraphSize) - 1;
-  for (size_t mask = 1; mask < possibleVertexesInSecondGraph.size(); ++mask) {
-    if ((mask & (1 << (maxBitPos + 1))) != 0) {
-      ++maxBitPos;
-    }
-
-    // vertexes that are achieved from every vertex from mask except [maxBitPos]
-    // vertex BIT_AND with all vertexes I can achieve from the [maxBitPos]
-    // vertex. Results in all vertexes I can achieve from each vertex from mask
-    possibleVertexesInSecondGraph[mask] =
-        possibleVertexesInSecondGraph[mask & ~(1 << maxBitPos)] &
-        firstToSecondGraphEdges[maxBitPos];
-  }
+  possibleVertexesInSecondGraph[0] = (uint64_t{1} << secondGraphSize) - 1;
+  fillByLevels(possibleVertexesInSecondGraph.size(), threadPool,
+               [&](uint64_t mask, size_t maxBitPos) {
+                 // vertexes that are achieved from every vertex from mask
+                 // except [maxBitPos] vertex BIT_AND with all vertexes I can
+                 // achieve from the [maxBitPos] vertex. Results in all vertexes
+                 // I can achieve from each vertex from mask
+                 uint64_t withoutMaxBit = mask & ~(uint64_t{1} << maxBitPos);
+                 possibleVertexesInSecondGraph[mask] =
+                     possibleVertexesInSecondGraph[withoutMaxBit] &
+                     firstToSecondGraphEdges[maxBitPos];
+               });
 
   return possibleVertexesInSecondGraph;
 }
@@ -121,104 +394,574 @@ std::pair<Graph, Graph> splitOnGraphs(
   return {Graph(firstGraph), Graph(secondGraph)};
 }
 
-std::vector<bool> findIsCliqueArray(const Graph& graph) {
+BitArray findIsCliqueArray(const Graph& graph, ThreadPool& threadPool) {
   size_t size = graph.size();
+  assert(size < MaxMaskBits);
+
+  BitArray isClique(uint64_t{1} << size);
+  isClique.set(0);
+
+  fillByLevels(isClique.size(), threadPool,
+               [&](uint64_t mask, size_t maxBitPos) {
+                 // checking if [maxBitPos] vertex is connected with all other
+                 // vertexes in mask. If yes - it is clique only when mask
+                 // without [maskBitPos] vertex is clique
+                 if ((mask & graph.getEdgesMask(maxBitPos)) == mask &&
+                     isClique.get(mask & ~(uint64_t{1} << maxBitPos))) {
+                   isClique.set(mask);
+                 }
+               });
 
-  std::vector<bool> isClique((1 << size), false);
-  isClique[0] = true;
+  return isClique;
+}
 
-  size_t maxBitPos = 0;
-  for (size_t mask = 1; mask < isClique.size(); ++mask) {
-    if ((mask & (1 << (maxBitPos + 1))) != 0) {
-      ++maxBitPos;
-    }
+std::vector<uint64_t> findNCliquesArray(const Graph& graph,
+                                        ThreadPool& threadPool) {
+  size_t size = graph.size();
+  assert(size < MaxMaskBits);
+
+  std::vector<uint64_t> nCliques(uint64_t{1} << size, 0);
+  nCliques[0] = 1;
+
+  fillByLevels(
+      nCliques.size(), threadPool, [&](uint64_t mask, size_t maxBitPos) {
+        // nCliques[mask & graph.getEdgesMask(maxBitPos) & ~(1 << maxBitPos)]:
+        // Get all vertexes that can be achieved from [maxBitPos] vertex, find
+        // nCliques on that vertexes, now connecting all this vertexes to
+        // [maxBitPos] vertex - it still a clique because all of that vertexes
+        // are achieved from [maxBitPos]
+
+        // nCliques[mask & ~(1 << maxBitPos)] - simply all cliques without
+        // [maxBitPos] vertex
+        uint64_t withoutMaxBit = mask & ~(uint64_t{1} << maxBitPos);
+        nCliques[mask] =
+            nCliques[withoutMaxBit] +
+            nCliques[withoutMaxBit & graph.getEdgesMask(maxBitPos)];
+      });
 
-    // checking if [maxBitPos] vertex is connected with all other vertexes in
-    // mask. If yes - it is clique only when mask without [maskBitPos] vertex is
-    // clique
-    if ((mask & graph.getEdgesMask(maxBitPos)) == mask) {
-      isClique[mask] = isClique[mask & ~(1 << maxBitPos)];
+  return nCliques;
+}
+
+// Number of cliques, the empty one included, on the candidates vertexes.
+// Pivoting on the candidate with the most candidate neighbours: cliques inside
+// its neighbourhood are counted once with and once without the pivot, any
+// other clique by its first vertex that is not adjacent to the pivot
+uint64_t countCliques(const std::vector<VertexSet>& neighbours,
+                      VertexSet candidates) {
+  if (candidates.empty()) {
+    return 1;
+  }
+
+  size_t pivot = candidates.front();
+  size_t maxPivotDegree = 0;
+  for (VertexSet rest = candidates; !rest.empty();) {
+    size_t vertex = rest.front();
+    rest.erase(vertex);
+
+    size_t degree = (candidates & neighbours[vertex]).count();
+    if (degree > maxPivotDegree) {
+      pivot = vertex;
+      maxPivotDegree = degree;
     }
   }
 
-  return isClique;
+  uint64_t nCliques = 2 * countCliques(neighbours,
+                                       candidates & neighbours[pivot]);
+
+  VertexSet branches = candidates.without(neighbours[pivot]);
+  branches.erase(pivot);
+  while (!branches.empty()) {
+    size_t vertex = branches.front();
+    branches.erase(vertex);
+
+    nCliques += countCliques(neighbours, candidates & neighbours[vertex]);
+    candidates.erase(vertex);
+  }
+
+  return nCliques;
 }
 
-std::vector<uint64_t> findNCliquesArray(const Graph& graph) {
+// vertexes in the order of removing one of minimal degree at a time
+std::vector<size_t> findDegeneracyOrder(const Graph& graph) {
   size_t size = graph.size();
 
-  std::vector<uint64_t> nCliques((1 << size), 0);
-  nCliques[0] = 1;
+  std::vector<size_t> degrees(size);
+  for (size_t vertex = 0; vertex < size; ++vertex) {
+    // without the loop on itself
+    degrees[vertex] = graph.getEdgesSet(vertex).count() - 1;
+  }
 
-  size_t maxBitPos = 0;
+  std::vector<size_t> order;
+  std::vector<bool> isRemoved(size, false);
+  for (size_t step = 0; step < size; ++step) {
+    size_t minVertex = size;
+    for (size_t vertex = 0; vertex < size; ++vertex) {
+      if (!isRemoved[vertex] &&
+          (minVertex == size || degrees[vertex] < degrees[minVertex])) {
+        minVertex = vertex;
+      }
+    }
 
-  for (size_t mask = 1; mask < nCliques.size(); ++mask) {
-    if ((mask & (1 << (maxBitPos + 1))) != 0) {
-      ++maxBitPos;
+    order.push_back(minVertex);
+    isRemoved[minVertex] = true;
+    for (VertexSet rest = graph.getEdgesSet(minVertex); !rest.empty();) {
+      size_t vertex = rest.front();
+      rest.erase(vertex);
+      if (!isRemoved[vertex]) {
+        --degrees[vertex];
+      }
     }
+  }
+
+  return order;
+}
 
-    // nCliques[mask & graph.getEdgesMask(maxBitPos) & ~(1 << maxBitPos)]:
-    // Get all vertexes that can be achieved from [maxBitPos] vertex, find
-    // nCliques on that vertexes, now connecting all this vertexes to
-    // [maxBitPos] vertex - it still a clique because all of that vertexes are
-    // achieved from [maxBitPos]
+// the largest number of later neighbours of a vertex in the order
+size_t findDegeneracy(const Graph& graph, const std::vector<size_t>& order) {
+  VertexSet laterVertexes;
+  for (size_t vertex : order) {
+    laterVertexes.insert(vertex);
+  }
 
-    // nCliques[mask & ~(1 << maxBitPos)] - simply all cliques without
-    // [maxBitPos] vertex
-    nCliques[mask] =
-        nCliques[mask & ~(1 << maxBitPos)] +
-        nCliques[mask & graph.getEdgesMask(maxBitPos) & ~(1 << maxBitPos)];
+  size_t degeneracy = 0;
+  for (size_t vertex : order) {
+    laterVertexes.erase(vertex);
+    degeneracy = std::max(
+        degeneracy, (graph.getEdgesSet(vertex) & laterVertexes).count());
   }
 
-  return nCliques;
+  return degeneracy;
 }
 
-uint64_t findEndDay(const std::vector<std::vector<int> >& friends) {
-  size_t numberOfRobots = friends.size();
+// edges sets without the loops
+std::vector<VertexSet> findNeighbours(const Graph& graph) {
+  std::vector<VertexSet> neighbours(graph.size());
+  for (size_t vertex = 0; vertex < graph.size(); ++vertex) {
+    neighbours[vertex] = graph.getEdgesSet(vertex);
+    neighbours[vertex].erase(vertex);
+  }
 
-  if (numberOfRobots == 1) {
-    return 2;
+  return neighbours;
+}
+
+// Each clique is counted from its first vertex in the degeneracy order, so
+// the candidates never exceed the degeneracy
+uint64_t findEndDayByPivoting(const Graph& graph,
+                              const std::vector<size_t>& order) {
+  std::vector<VertexSet> neighbours = findNeighbours(graph);
+  VertexSet laterVertexes;
+  for (size_t vertex = 0; vertex < graph.size(); ++vertex) {
+    laterVertexes.insert(vertex);
   }
 
-  size_t firstGraphSize = numberOfRobots / 2;
+  uint64_t endDay = 1;
+  for (size_t vertex : order) {
+    laterVertexes.erase(vertex);
+    endDay += countCliques(neighbours, neighbours[vertex] & laterVertexes);
+  }
+
+  return endDay;
+}
+
+// Bytes of possibleVertexesInSecondGraph and isClique for the first half,
+// nCliques or the histogram and its isClique for the second
+double estimateTablesBytes(size_t firstGraphSize, size_t secondGraphSize) {
+  double firstEntries = std::ldexp(1.0, firstGraphSize);
+  double secondEntries = std::ldexp(1.0, secondGraphSize);
+
+  return (firstEntries + secondEntries) *
+         (sizeof(uint64_t) + 1.0 / __CHAR_BIT__);
+}
+
+// Both halves cost the same bytes per entry, and 2^f + 2^(n - f) is the
+// smallest for f = n / 2, so the balanced split is the one that needs the
+// least memory
+size_t chooseFirstGraphSize(size_t numberOfRobots) {
+  return numberOfRobots / 2;
+}
+
+enum class EndDayEngine {
+  Auto,
+  // meet in the middle over the subsets of two halves
+  Split,
+  // findEndDayByPivoting
+  Pivoting,
+};
+
+// How findEndDayBySplit combines the cliques of the two halves
+enum class CliquesCombination {
+  // nCliques[possibleVertexesInSecondGraph[mask]] for every clique mask
+  Gather,
+  // combineCliquesByHistogram
+  Histogram,
+};
+
+struct EndDayOptions {
+  double memoryBudget = std::ldexp(1.0, 32);
+  size_t nThreads = 1;
+  EndDayEngine engine = EndDayEngine::Auto;
+  CliquesCombination combination = CliquesCombination::Gather;
+};
+
+// sums modulo 2^64, so the order of the partial sums does not matter
+template <typename Term>
+uint64_t sumOverMasks(uint64_t nMasks, ThreadPool& threadPool, Term term) {
+  uint64_t blockSize = std::min(nMasks, ParallelMaskBlock);
+  std::vector<uint64_t> partialSums(nMasks / blockSize, 0);
+  threadPool.parallelFor(partialSums.size(), [&](size_t block) {
+    uint64_t sum = 0;
+    for (uint64_t mask = block * blockSize; mask < (block + 1) * blockSize;
+         ++mask) {
+      sum += term(mask);
+    }
+    partialSums[block] = sum;
+  });
+
+  uint64_t sum = 0;
+  for (uint64_t partialSum : partialSums) {
+    sum += partialSum;
+  }
+
+  return sum;
+}
+
+uint64_t combineCliquesByGather(
+    const BitArray& isClique,
+    const std::vector<uint64_t>& possibleVertexesInSecondGraph,
+    const Graph& secondGraph, ThreadPool& threadPool) {
+  std::vector<uint64_t> nCliques = findNCliquesArray(secondGraph, threadPool);
+  assert(nCliques.size() == (uint64_t{1} << secondGraph.size()));
+
+  return sumOverMasks(isClique.size(), threadPool, [&](uint64_t mask) {
+    // for each clique from graph1 find number of cliques from second graph
+    // so that their connection is still a clique.
+    return isClique.get(mask) ? nCliques[possibleVertexesInSecondGraph[mask]]
+                              : 0;
+  });
+}
+
+// Adds to every mask of the table the values of all its supermasks. The bits
+// inside a block are done while the block is in cache, every higher pair of
+// bits takes one sequential pass over the table
+void sumOverSupermasks(std::vector<uint64_t>& table, ThreadPool& threadPool) {
+  uint64_t blockSize = std::min<uint64_t>(table.size(), ParallelMaskBlock);
+  uint64_t nBlocks = table.size() / blockSize;
+
+  threadPool.parallelFor(nBlocks, [&](size_t block) {
+    uint64_t* values = table.data() + block * blockSize;
+    for (uint64_t bit = 1; bit < blockSize; bit <<= 1) {
+      for (uint64_t base = 0; base < blockSize; base += 2 * bit) {
+        uint64_t* withoutBit = values + base;
+        uint64_t* withBit = withoutBit + bit;
+        for (uint64_t i = 0; i < bit; ++i) {
+          withoutBit[i] += withBit[i];
+        }
+      }
+    }
+  });
+
+  for (uint64_t bit = blockSize; bit < table.size(); bit <<= 2) {
+    // the next bit too, if there is one
+    uint64_t nextBit = 2 * bit < table.size() ? 2 * bit : 0;
+    uint64_t bits = bit | nextBit;
+    threadPool.parallelFor(nBlocks, [&](size_t block) {
+      uint64_t begin = block * blockSize;
+      if ((begin & bits) != 0) return;
+
+      uint64_t* values = table.data() + begin;
+      uint64_t* withBit = values + bit;
+      uint64_t* withNextBit = values + nextBit;
+      uint64_t* withBoth = values + bits;
+      for (uint64_t i = 0; i < blockSize; ++i) {
+        if (nextBit != 0) {
+          values[i] += withNextBit[i];
+          withNextBit[i] += withBoth[i];
+          withBit[i] += withBoth[i];
+        }
+        values[i] += withBit[i];
+      }
+    });
+  }
+}
+
+// Counts the first half cliques by their possibleVertexesInSecondGraph and
+// sums the counts over supermasks, so that a second half clique mask gets the
+// number of first half cliques it can join. Only the histogram is written in
+// random order, the rest are sequential passes
+uint64_t combineCliquesByHistogram(
+    const BitArray& isClique,
+    const std::vector<uint64_t>& possibleVertexesInSecondGraph,
+    const Graph& secondGraph, ThreadPool& threadPool) {
+  std::vector<uint64_t> nJoinableCliques(uint64_t{1} << secondGraph.size(),
+                                         0);
+
+  uint64_t nMasks = isClique.size();
+  uint64_t blockSize = std::min(nMasks, ParallelMaskBlock);
+  threadPool.parallelFor(nMasks / blockSize, [&](size_t block) {
+    for (uint64_t mask = block * blockSize; mask < (block + 1) * blockSize;
+         ++mask) {
+      if (!isClique.get(mask)) continue;
+
+      uint64_t& count = nJoinableCliques[possibleVertexesInSecondGraph[mask]];
+      if (threadPool.size() == 1) {
+        ++count;
+      } else {
+        std::atomic_ref<uint64_t>(count).fetch_add(1,
+                                                   std::memory_order_relaxed);
+      }
+    }
+  });
+
+  sumOverSupermasks(nJoinableCliques, threadPool);
+
+  BitArray isSecondClique = findIsCliqueArray(secondGraph, threadPool);
+
+  return sumOverMasks(isSecondClique.size(), threadPool, [&](uint64_t mask) {
+    return isSecondClique.get(mask) ? nJoinableCliques[mask] : 0;
+  });
+}
+
+// std::nullopt when the tables would not fit into options.memoryBudget bytes
+std::optional<uint64_t> findEndDayBySplit(
+    const std::vector<std::vector<int> >& friends,
+    const EndDayOptions& options) {
+  size_t numberOfRobots = friends.size();
+
+  size_t firstGraphSize = chooseFirstGraphSize(numberOfRobots);
   size_t secondGraphSize = numberOfRobots - firstGraphSize;
 
+  // checked before the first allocation, not after minutes of swapping
+  if (estimateTablesBytes(firstGraphSize, secondGraphSize) >
+      options.memoryBudget) {
+    return std::nullopt;
+  }
+
+  ThreadPool threadPool(options.nThreads);
+
   // for each mask1 from graph1 finding such mask2 vertexes from second graph so
   // that from EACH vertex from mask1 I can achieve EACH vertex from mask2
-  std::vector<uint32_t> possibleVertexesInSecondGraph =
+  std::vector<uint64_t> possibleVertexesInSecondGraph =
       findPossibleVertexesInSecondGraph(friends, firstGraphSize,
-                                        secondGraphSize);
+                                        secondGraphSize, threadPool);
 
-  assert(possibleVertexesInSecondGraph.size() == (1 << firstGraphSize));
+  assert(possibleVertexesInSecondGraph.size() ==
+         (uint64_t{1} << firstGraphSize));
 
   auto [firstGraph, secondGraph] =
       splitOnGraphs(friends, firstGraphSize, secondGraphSize);
 
-  std::vector<bool> isClique = findIsCliqueArray(firstGraph);
-
-  std::vector<uint64_t> nCliques = findNCliquesArray(secondGraph);
+  BitArray isClique = findIsCliqueArray(firstGraph, threadPool);
 
   assert(isClique.size() == possibleVertexesInSecondGraph.size());
-  assert(nCliques.size() == (1 << secondGraphSize));
 
-  uint64_t endDay = 0;
-  for (size_t mask = 0; mask < possibleVertexesInSecondGraph.size(); ++mask) {
-    if (!isClique[mask]) continue;
+  if (options.combination == CliquesCombination::Histogram) {
+    return combineCliquesByHistogram(isClique, possibleVertexesInSecondGraph,
+                                     secondGraph, threadPool);
+  }
 
-    // for each clique from graph1 find number of cliques from second graph
-    // so that their connection is still a clique.
-    endDay += nCliques[possibleVertexesInSecondGraph[mask]];
+  return combineCliquesByGather(isClique, possibleVertexesInSecondGraph,
+                                secondGraph, threadPool);
+}
+
+// Pivoting makes at most about n * 3^(d / 3) calls for degeneracy d, the
+// split fills 2^(n / 2)-entry tables whatever the edges are
+bool isPivotingCheaper(size_t numberOfRobots, size_t degeneracy,
+                       const EndDayOptions& options) {
+  size_t firstGraphSize = chooseFirstGraphSize(numberOfRobots);
+  size_t secondGraphSize = numberOfRobots - firstGraphSize;
+  if (estimateTablesBytes(firstGraphSize, secondGraphSize) >
+      options.memoryBudget) {
+    return true;
   }
 
-  return endDay;
+  double pivotingCalls =
+      numberOfRobots * std::pow(3.0, static_cast<double>(degeneracy) / 3);
+  double splitEntries =
+      std::ldexp(1.0, firstGraphSize) + std::ldexp(1.0, secondGraphSize);
+
+  return pivotingCalls <= splitEntries;
+}
+
+std::optional<uint64_t> findEndDay(
+    const std::vector<std::vector<int> >& friends,
+    const EndDayOptions& options = {}) {
+  if (friends.size() == 1) {
+    return 2;
+  }
+
+  EndDayEngine engine = options.engine;
+  if (engine == EndDayEngine::Split) {
+    return findEndDayBySplit(friends, options);
+  }
+
+  Graph graph(friends);
+  std::vector<size_t> order = findDegeneracyOrder(graph);
+  if (engine == EndDayEngine::Auto &&
+      !isPivotingCheaper(friends.size(), findDegeneracy(graph, order),
+                         options)) {
+    return findEndDayBySplit(friends, options);
+  }
+
+  return findEndDayByPivoting(graph, order);
+}
+
+// Keeps endDay up to date while friendships appear and disappear: the cliques
+// gained or lost are exactly those with both robots, that is the cliques of
+// their common neighbourhood with the two robots added
+class EndDayTracker {
+  std::vector<VertexSet> neighbours_;
+  uint64_t endDay_;
+
+  uint64_t countCliquesWithFriendship(size_t first, size_t second) const;
+
+  // two different robots of the graph
+  bool isValidFriendship(size_t first, size_t second) const;
+
+ public:
+  EndDayTracker(const std::vector<std::vector<int> >& friends,
+                uint64_t endDay);
+
+  uint64_t getEndDay() const;
+
+  // false, with nothing changed, for an invalid pair of robots
+  bool addFriendship(size_t first, size_t second);
+
+  bool removeFriendship(size_t first, size_t second);
+};
+
+EndDayTracker::EndDayTracker(const std::vector<std::vector<int> >& friends,
+                             uint64_t endDay)
+    : neighbours_(findNeighbours(Graph(friends))), endDay_(endDay) {}
+
+uint64_t EndDayTracker::getEndDay() const { return endDay_; }
+
+uint64_t EndDayTracker::countCliquesWithFriendship(size_t first,
+                                                   size_t second) const {
+  return countCliques(neighbours_, neighbours_[first] & neighbours_[second]);
+}
+
+bool EndDayTracker::isValidFriendship(size_t first, size_t second) const {
+  return first != second && first < neighbours_.size() &&
+         second < neighbours_.size();
+}
+
+bool EndDayTracker::addFriendship(size_t first, size_t second) {
+  if (!isValidFriendship(first, second)) {
+    return false;
+  }
+  if (neighbours_[first].contains(second)) {
+    return true;
+  }
+
+  endDay_ += countCliquesWithFriendship(first, second);
+  neighbours_[first].insert(second);
+  neighbours_[second].insert(first);
+  return true;
+}
+
+bool EndDayTracker::removeFriendship(size_t first, size_t second) {
+  if (!isValidFriendship(first, second)) {
+    return false;
+  }
+  if (!neighbours_[first].contains(second)) {
+    return true;
+  }
+
+  neighbours_[first].erase(second);
+  neighbours_[second].erase(first);
+  endDay_ -= countCliquesWithFriendship(first, second);
+  return true;
+}
+
+// "+ u v" or "- u v" per line, robots numbered from 0. False on the first
+// update that is not one of those
+bool processFriendshipUpdates(EndDayTracker& tracker) {
+  size_t nUpdates = 0;
+  std::cin >> nUpdates;
+
+  for (size_t i = 0; i < nUpdates; ++i) {
+    char sign = 0;
+    size_t first = 0;
+    size_t second = 0;
+    std::cin >> sign >> first >> second;
+
+    bool isApplied = false;
+    if (std::cin && sign == '+') {
+      isApplied = tracker.addFriendship(first, second);
+    } else if (std::cin && sign == '-') {
+      isApplied = tracker.removeFriendship(first, second);
+    }
+
+    if (!isApplied) {
+      std::cerr << "Invalid update " << i + 1 << ": " << sign << " " << first
+                << " " << second << "\n";
+      return false;
+    }
+
+    std::cout << tracker.getEndDay() << "\n";
+  }
+
+  return true;
 }
 
-int main() {
+int main(int argc, char** argv) {
+  EndDayOptions options;
+  bool isUpdatesMode = false;
+  for (int i = 1; i < argc; ++i) {
+    std::string option = argv[i];
+    if (option == "--memory-budget" && i + 1 < argc) {
+      options.memoryBudget = std::stod(argv[++i]);
+    } else if (option == "--threads" && i + 1 < argc) {
+      options.nThreads = std::max(std::stoul(argv[++i]), 1ul);
+    } else if (option == "--combine" && i + 1 < argc) {
+      std::string combination = argv[++i];
+      if (combination == "gather") {
+        options.combination = CliquesCombination::Gather;
+      } else if (combination == "histogram") {
+        options.combination = CliquesCombination::Histogram;
+      } else {
+        std::cerr << "Unknown combination " << combination << "\n";
+        return 1;
+      }
+    } else if (option == "--updates") {
+      isUpdatesMode = true;
+    } else if (option == "--engine" && i + 1 < argc) {
+      std::string engine = argv[++i];
+      if (engine == "split") {
+        options.engine = EndDayEngine::Split;
+      } else if (engine == "pivoting") {
+        options.engine = EndDayEngine::Pivoting;
+      } else {
+        std::cerr << "Unknown engine " << engine << "\n";
+        return 1;
+      }
+    } else {
+      std::cerr << "Unknown option " << option << "\n";
+      return 1;
+    }
+  }
+
   auto friendsGraph = readFriendsGraph();
 
-  uint64_t endDay = findEndDay(friendsGraph);
+  std::optional<uint64_t> endDay = findEndDay(friendsGraph, options);
+  if (!endDay) {
+    size_t firstGraphSize = chooseFirstGraphSize(friendsGraph.size());
+    std::cerr << "Clique tables need "
+              << estimateTablesBytes(firstGraphSize,
+                                     friendsGraph.size() - firstGraphSize)
+              << " bytes, over the budget of " << options.memoryBudget
+              << "\n";
+    return 1;
+  }
 
-  std::cout << endDay << "\n";
+  std::cout << *endDay << "\n";
+
+  if (isUpdatesMode) {
+    EndDayTracker tracker(friendsGraph, *endDay);
+    if (!processFriendshipUpdates(tracker)) {
+      return 1;
+    }
+  }
 
   return 0;
 }
@@ -1,17 +1,47 @@
 #include <algorithm>
 #include <cassert>
+#include <condition_variable>
 #include <cstddef>
 #include <cstdint>
 #include <cstdio>
+#include <functional>
 #include <iostream>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
 #include <vector>
 
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
+// Barrett reduction for a modulus known only at runtime. Moduli below 2^32
+// replace the division with one high multiplication, bigger ones (up to 2^63)
+// fall back to the 128-bit remainder so that products never overflow.
+class BarrettReduction {
+ public:
+  explicit BarrettReduction(uint64_t mod);
+
+  uint64_t mod() const { return mod_; }
+
+  uint64_t reduce(unsigned __int128 value) const;
+
+  uint64_t multiply(uint64_t a, uint64_t b) const;
+  uint64_t add(uint64_t a, uint64_t b) const;
+
+ private:
+  uint64_t mod_;
+  uint64_t factor_;
+};
+
 class ModuloRingUint64 {
  public:
-  ModuloRingUint64(uint64_t initVal, uint32_t mod)
-      : value_(initVal % mod), mod_(mod) {}
+  ModuloRingUint64(uint64_t initVal, const BarrettReduction& reduction)
+      : value_(initVal % reduction.mod()), reduction_(&reduction) {}
 
-  void value(uint64_t initVal) { value_ = initVal % mod_; }
+  void value(uint64_t initVal) { value_ = initVal % reduction_->mod(); }
   uint64_t value() const { return value_; }
 
   operator uint64_t() const { return value_; }
@@ -21,91 +51,335 @@ class ModuloRingUint64 {
 
  private:
   uint64_t value_;
-  uint32_t mod_;
+  const BarrettReduction* reduction_;
+};
+
+// Non-negative integer in base 2^32, least significant limb first, without
+// leading zero limbs.
+class BinaryBigInt {
+ public:
+  // walks the bits from the least significant one
+  class BitIterator {
+   public:
+    BitIterator(const BinaryBigInt& number, size_t pos)
+        : number_(&number), pos_(pos) {}
+
+    bool operator*() const { return number_->bit(pos_); }
+
+    BitIterator& operator++() {
+      ++pos_;
+      return *this;
+    }
+
+    bool operator!=(const BitIterator& other) const {
+      return pos_ != other.pos_;
+    }
+
+   private:
+    const BinaryBigInt* number_;
+    size_t pos_;
+  };
+
+  BinaryBigInt() = default;
+  explicit BinaryBigInt(uint64_t value);
+
+  BinaryBigInt& operator--();
+
+  friend BinaryBigInt operator+(const BinaryBigInt& a, const BinaryBigInt& b);
+  friend BinaryBigInt operator*(const BinaryBigInt& a, const BinaryBigInt& b);
+
+  bool bit(size_t pos) const {
+    return pos / 32 < limbs_.size() && ((limbs_[pos / 32] >> (pos % 32)) & 1);
+  }
+
+  size_t bitLength() const;
+
+  BitIterator begin() const { return BitIterator(*this, 0); }
+  BitIterator end() const { return BitIterator(*this, bitLength()); }
+
+  bool isZero() const { return limbs_.empty(); }
+
+ private:
+  using Limbs = std::vector<uint32_t>;
+
+  explicit BinaryBigInt(Limbs limbs);
+
+  static void trim(Limbs& limbs);
+  static void addShifted(Limbs& res, const Limbs& value, size_t shift);
+  static void subtract(Limbs& res, const Limbs& value);
+
+  static Limbs multiplySchoolbook(const Limbs& a, const Limbs& b);
+  static Limbs multiplyKaratsuba(const Limbs& a, const Limbs& b);
+
+  Limbs limbs_;
 };
 
-struct DivisionByTwoResult;
+// Non-negative integer in base 10^9, least significant limb first.
 class DecimalBigInt {
-  std::vector<uint8_t> digits_;
+  std::vector<uint32_t> limbs_;
 
  public:
   DecimalBigInt() = default;
   DecimalBigInt(const std::string& value);
 
-  DecimalBigInt& operator--();
-  DivisionByTwoResult divideByTwo() const;
+  // divide and conquer over limb ranges: O(M(n) log n) with Karatsuba M(n)
+  BinaryBigInt convertToBinary() const;
 
-  std::string convertToBinary() const;
-
-  bool isZero() const;
+ private:
+  BinaryBigInt convertRangeToBinary(
+      size_t begin, size_t end,
+      const std::vector<BinaryBigInt>& chunkPowers) const;
 };
 
-struct DivisionByTwoResult {
-  DecimalBigInt result;
-  int reminder;
-};
+BinaryBigInt::BinaryBigInt(uint64_t value) {
+  for (; value != 0; value >>= 32) {
+    limbs_.push_back(static_cast<uint32_t>(value));
+  }
+}
 
-DecimalBigInt::DecimalBigInt(const std::string& value) {
-  digits_.resize(value.size());
+BinaryBigInt::BinaryBigInt(Limbs limbs) : limbs_(std::move(limbs)) {
+  trim(limbs_);
+}
+
+void BinaryBigInt::trim(Limbs& limbs) {
+  while (!limbs.empty() && limbs.back() == 0) {
+    limbs.pop_back();
+  }
+}
 
-  for (size_t i = 0; i < value.size(); ++i) {
-    digits_[i] = static_cast<uint8_t>(value[i]) - static_cast<uint8_t>('0');
+size_t BinaryBigInt::bitLength() const {
+  if (limbs_.empty()) {
+    return 0;
   }
 
-  std::reverse(digits_.begin(), digits_.end());
+  return 32 * limbs_.size() - __builtin_clz(limbs_.back());
 }
 
-bool DecimalBigInt::isZero() const {
-  for (size_t i = 0; i < digits_.size(); ++i) {
-    if (digits_[i] != 0) {
-      return false;
+BinaryBigInt& BinaryBigInt::operator--() {
+  assert(!isZero());
+
+  for (size_t i = 0; i < limbs_.size(); ++i) {
+    if (limbs_[i]-- != 0) {
+      break;
     }
   }
 
-  return true;
+  trim(limbs_);
+  return *this;
 }
 
-DivisionByTwoResult DecimalBigInt::divideByTwo() const {
-  DecimalBigInt result;
-  int carry = 0;
-  int len = digits_.size();
-  for (ssize_t i = len - 1; i >= 0; --i) {
-    int value = (carry * 10) + digits_[i];
-    result.digits_.push_back(value / 2);
-    carry = value % 2;
+// res += value * 2^(32 * shift)
+void BinaryBigInt::addShifted(Limbs& res, const Limbs& value, size_t shift) {
+  if (res.size() < value.size() + shift) {
+    res.resize(value.size() + shift, 0);
   }
 
-  std::reverse(result.digits_.begin(), result.digits_.end());
-  return {result, carry};
+  uint64_t carry = 0;
+  size_t i = 0;
+  for (; i < value.size(); ++i) {
+    carry += static_cast<uint64_t>(res[i + shift]) + value[i];
+    res[i + shift] = static_cast<uint32_t>(carry);
+    carry >>= 32;
+  }
+
+  for (i += shift; carry != 0; ++i) {
+    if (i == res.size()) {
+      res.push_back(0);
+    }
+
+    carry += res[i];
+    res[i] = static_cast<uint32_t>(carry);
+    carry >>= 32;
+  }
+}
+
+// res -= value, res must not be smaller than value
+void BinaryBigInt::subtract(Limbs& res, const Limbs& value) {
+  int64_t borrow = 0;
+  for (size_t i = 0; i < res.size() && (i < value.size() || borrow != 0);
+       ++i) {
+    int64_t difference = static_cast<int64_t>(res[i]) - borrow -
+                         (i < value.size() ? value[i] : 0);
+    borrow = difference < 0 ? 1 : 0;
+    res[i] = static_cast<uint32_t>(difference + (borrow << 32));
+  }
+
+  assert(borrow == 0);
+  trim(res);
 }
 
-DecimalBigInt& DecimalBigInt::operator--() {
-  for (size_t i = 0; i < digits_.size(); ++i) {
-    assert(digits_[i] <= 9);
+BinaryBigInt::Limbs BinaryBigInt::multiplySchoolbook(const Limbs& a,
+                                                     const Limbs& b) {
+  if (a.empty() || b.empty()) {
+    return {};
+  }
 
-    if (digits_[i] != 0) {
-      digits_[i]--;
-      break;
+  Limbs res(a.size() + b.size(), 0);
+  for (size_t i = 0; i < a.size(); ++i) {
+    uint64_t carry = 0;
+    for (size_t j = 0; j < b.size(); ++j) {
+      carry += static_cast<uint64_t>(a[i]) * b[j] + res[i + j];
+      res[i + j] = static_cast<uint32_t>(carry);
+      carry >>= 32;
     }
+    res[i + b.size()] = static_cast<uint32_t>(carry);
+  }
 
-    digits_[i] = 9;
+  trim(res);
+  return res;
+}
+
+BinaryBigInt::Limbs BinaryBigInt::multiplyKaratsuba(const Limbs& a,
+                                                    const Limbs& b) {
+  static const size_t KaratsubaThreshold = 48;
+
+  if (std::min(a.size(), b.size()) <= KaratsubaThreshold) {
+    return multiplySchoolbook(a, b);
   }
 
-  return *this;
+  const size_t half = std::max(a.size(), b.size()) / 2;
+
+  auto lowPart = [half](const Limbs& value) {
+    Limbs low(value.begin(), value.begin() + std::min(half, value.size()));
+    trim(low);
+    return low;
+  };
+  auto highPart = [half](const Limbs& value) {
+    return value.size() <= half ? Limbs{}
+                                : Limbs(value.begin() + half, value.end());
+  };
+
+  Limbs aLow = lowPart(a), aHigh = highPart(a);
+  Limbs bLow = lowPart(b), bHigh = highPart(b);
+
+  Limbs res;
+  if (bHigh.empty() || aHigh.empty()) {
+    // unbalanced operands: one of them fits in the lower half
+    const Limbs& shorter = aHigh.empty() ? a : b;
+    addShifted(res, multiplyKaratsuba(aHigh.empty() ? bLow : aLow, shorter), 0);
+    addShifted(res, multiplyKaratsuba(aHigh.empty() ? bHigh : aHigh, shorter),
+               half);
+    trim(res);
+    return res;
+  }
+
+  Limbs lowProduct = multiplyKaratsuba(aLow, bLow);
+  Limbs highProduct = multiplyKaratsuba(aHigh, bHigh);
+
+  Limbs aSum = aLow, bSum = bLow;
+  addShifted(aSum, aHigh, 0);
+  addShifted(bSum, bHigh, 0);
+
+  Limbs middleProduct = multiplyKaratsuba(aSum, bSum);
+  subtract(middleProduct, lowProduct);
+  subtract(middleProduct, highProduct);
+
+  res = lowProduct;
+  addShifted(res, middleProduct, half);
+  addShifted(res, highProduct, 2 * half);
+  trim(res);
+
+  return res;
+}
+
+BinaryBigInt operator+(const BinaryBigInt& a, const BinaryBigInt& b) {
+  BinaryBigInt::Limbs res = a.limbs_;
+  BinaryBigInt::addShifted(res, b.limbs_, 0);
+  return BinaryBigInt(std::move(res));
+}
+
+BinaryBigInt operator*(const BinaryBigInt& a, const BinaryBigInt& b) {
+  return BinaryBigInt(BinaryBigInt::multiplyKaratsuba(a.limbs_, b.limbs_));
+}
+
+const uint32_t DecimalLimbBase = 1000000000;
+const size_t DecimalLimbDigits = 9;
+
+DecimalBigInt::DecimalBigInt(const std::string& value) {
+  for (size_t end = value.size(); end > 0;) {
+    size_t begin = end >= DecimalLimbDigits ? end - DecimalLimbDigits : 0;
+
+    uint32_t limb = 0;
+    for (size_t i = begin; i < end; ++i) {
+      limb = limb * 10 + (static_cast<uint8_t>(value[i]) -
+                          static_cast<uint8_t>('0'));
+    }
+    limbs_.push_back(limb);
+
+    end = begin;
+  }
+
+  while (!limbs_.empty() && limbs_.back() == 0) {
+    limbs_.pop_back();
+  }
+}
+
+BinaryBigInt DecimalBigInt::convertRangeToBinary(
+    size_t begin, size_t end,
+    const std::vector<BinaryBigInt>& chunkPowers) const {
+  static const size_t DirectConversionLimbs = 16;
+
+  if (end - begin <= DirectConversionLimbs) {
+    BinaryBigInt res;
+    for (size_t i = end; i > begin; --i) {
+      res = res * BinaryBigInt(DecimalLimbBase) + BinaryBigInt(limbs_[i - 1]);
+    }
+
+    return res;
+  }
+
+  // split at the biggest power of two limbs below the range length, its
+  // multiplier 10^(9 * 2^level) is precomputed
+  size_t level = 0;
+  while ((size_t{2} << level) < end - begin) {
+    ++level;
+  }
+  size_t middle = begin + (size_t{1} << level);
+
+  return convertRangeToBinary(begin, middle, chunkPowers) +
+         convertRangeToBinary(middle, end, chunkPowers) * chunkPowers[level];
+}
+
+BinaryBigInt DecimalBigInt::convertToBinary() const {
+  size_t maxLevel = 0;
+  while ((size_t{2} << maxLevel) < limbs_.size()) {
+    ++maxLevel;
+  }
+
+  // chunkPowers[level] = 10^(9 * 2^level)
+  std::vector<BinaryBigInt> chunkPowers = {BinaryBigInt(DecimalLimbBase)};
+  while (chunkPowers.size() <= maxLevel) {
+    chunkPowers.push_back(chunkPowers.back() * chunkPowers.back());
+  }
+
+  return convertRangeToBinary(0, limbs_.size(), chunkPowers);
 }
 
-std::string DecimalBigInt::convertToBinary() const {
-  std::string binary;
+BarrettReduction::BarrettReduction(uint64_t mod)
+    : mod_(mod), factor_(UINT64_MAX / mod) {
+  assert(mod != 0 && mod < (uint64_t{1} << 63));
+}
 
-  DecimalBigInt decimal = *this;
+uint64_t BarrettReduction::reduce(unsigned __int128 value) const {
+  if (mod_ < (uint64_t{1} << 32) && (value >> 64) == 0) {
+    uint64_t x = static_cast<uint64_t>(value);
+    uint64_t quotient = static_cast<uint64_t>(
+        (static_cast<unsigned __int128>(x) * factor_) >> 64);
+    uint64_t result = x - quotient * mod_;
 
-  while (!decimal.isZero()) {
-    auto [afterDivision, reminder] = decimal.divideByTwo();
-    binary += std::to_string(reminder);
-    decimal = afterDivision;
+    return result >= mod_ ? result - mod_ : result;
   }
 
-  return binary;
+  return static_cast<uint64_t>(value % mod_);
+}
+
+uint64_t BarrettReduction::multiply(uint64_t a, uint64_t b) const {
+  return reduce(static_cast<unsigned __int128>(a) * b);
+}
+
+uint64_t BarrettReduction::add(uint64_t a, uint64_t b) const {
+  uint64_t result = a + b;
+  return result >= mod_ ? result - mod_ : result;
 }
 
 ModuloRingUint64 operator*(const ModuloRingUint64& first,
@@ -115,7 +389,7 @@ ModuloRingUint64 operator*(const ModuloRingUint64& first,
 }
 
 ModuloRingUint64& ModuloRingUint64::operator*=(const ModuloRingUint64& other) {
-  value_ = (value_ * other.value_) % mod_;
+  value_ = reduction_->multiply(value_, other.value_);
   return *this;
 }
 
@@ -126,102 +400,442 @@ ModuloRingUint64 operator+(const ModuloRingUint64& a,
 }
 
 ModuloRingUint64& ModuloRingUint64::operator+=(const ModuloRingUint64& other) {
-  value_ = (value_ + other.value_) % mod_;
+  value_ = reduction_->add(value_, other.value_);
   return *this;
 }
 
-template <typename T>
-class Matrix {
+// Fixed set of worker threads that run blocks of one task at a time, the
+// calling thread takes blocks too. A pool of size 1 runs everything inline.
+class ThreadPool {
+ public:
+  explicit ThreadPool(size_t nThreads);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  size_t size() const { return workers_.size() + 1; }
+
+  // runs task(block) for every block in [0, nBlocks), returns when all are done
+  void parallelFor(size_t nBlocks, const std::function<void(size_t)>& task);
+
  private:
-  struct MatrixLine {
-    std::vector<T>& matrixLine;
+  void runBlocks();
+  void workerLoop();
 
-    T& operator[](size_t pos) { return matrixLine[pos]; }
-  };
+  std::vector<std::thread> workers_;
+
+  std::mutex mutex_;
+  std::condition_variable taskReady_;
+  std::condition_variable taskDone_;
+
+  const std::function<void(size_t)>* task_ = nullptr;
+  size_t nBlocks_ = 0;
+  size_t nextBlock_ = 0;
+  size_t nFinishedBlocks_ = 0;
+  uint64_t generation_ = 0;
+  bool isStopping_ = false;
+};
+
+ThreadPool::ThreadPool(size_t nThreads) {
+  for (size_t i = 1; i < nThreads; ++i) {
+    workers_.emplace_back([this] { workerLoop(); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    isStopping_ = true;
+  }
+  taskReady_.notify_all();
+
+  for (std::thread& worker : workers_) {
+    worker.join();
+  }
+}
+
+void ThreadPool::parallelFor(size_t nBlocks,
+                             const std::function<void(size_t)>& task) {
+  if (nBlocks == 0) {
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    task_ = &task;
+    nBlocks_ = nBlocks;
+    nextBlock_ = 0;
+    nFinishedBlocks_ = 0;
+    ++generation_;
+  }
+  taskReady_.notify_all();
+
+  runBlocks();
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  taskDone_.wait(lock, [this] { return nFinishedBlocks_ == nBlocks_; });
+  task_ = nullptr;
+}
+
+void ThreadPool::runBlocks() {
+  std::unique_lock<std::mutex> lock(mutex_);
+
+  while (task_ != nullptr && nextBlock_ < nBlocks_) {
+    size_t block = nextBlock_++;
+    const std::function<void(size_t)>* task = task_;
+
+    lock.unlock();
+    (*task)(block);
+    lock.lock();
+
+    if (++nFinishedBlocks_ == nBlocks_) {
+      taskDone_.notify_all();
+    }
+  }
+}
+
+void ThreadPool::workerLoop() {
+  uint64_t seenGeneration = 0;
 
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      taskReady_.wait(lock, [&] {
+        return isStopping_ || generation_ != seenGeneration;
+      });
+
+      if (isStopping_) {
+        return;
+      }
+      seenGeneration = generation_;
+    }
+
+    runBlocks();
+  }
+}
+
+// Square matrix over Z/mod stored as one row-major buffer of reduced values,
+// the reduction is kept once per matrix instead of once per element. Products
+// are split by row blocks over threadPool when one is given.
+class Matrix {
  public:
-  Matrix(size_t size = 0, T initVal = T{});
+  Matrix(size_t size, const BarrettReduction& reduction, uint64_t initVal = 0,
+         ThreadPool* threadPool = nullptr);
+
+  Matrix& operator*=(const Matrix& other);
 
-  Matrix<T>& operator*=(const Matrix<T>& other);
+  uint64_t* operator[](size_t pos) { return values_.data() + pos * size_; }
+  const uint64_t* operator[](size_t pos) const {
+    return values_.data() + pos * size_;
+  }
+
+  size_t size() const { return size_; }
 
-  MatrixLine operator[](size_t pos) { return MatrixLine{matrix_[pos]}; }
+  const BarrettReduction& reduction() const { return reduction_; }
 
-  size_t size() const { return matrix_.size(); }
+  ThreadPool* threadPool() const { return threadPool_; }
 
-  template <typename U>
-  friend Matrix<U> operator*(const Matrix<U>& first, const Matrix<U>& second);
+  friend Matrix operator*(const Matrix& first, const Matrix& second);
 
  private:
-  std::vector<std::vector<T> > matrix_;
+  size_t size_;
+  BarrettReduction reduction_;
+  ThreadPool* threadPool_;
+  std::vector<uint64_t> values_;
 };
 
-template <typename T>
-Matrix<T>::Matrix(size_t size, T initVal) {
-  matrix_.resize(size, std::vector(size, initVal));
+Matrix::Matrix(size_t size, const BarrettReduction& reduction, uint64_t initVal,
+               ThreadPool* threadPool)
+    : size_(size),
+      reduction_(reduction),
+      threadPool_(threadPool),
+      values_(size * size, initVal % reduction.mod()) {}
+
+// Columns of the result are computed in panels of MatrixPanelWidth: the panel
+// of the right operand is packed into a contiguous size x 16 block that stays
+// in L2 while every row of the left operand streams over it, and the
+// accumulators of one panel row live in registers.
+const size_t MatrixPanelWidth = 16;
+
+// Rows of the result handed to one thread at a time.
+const size_t MatrixRowBlock = 32;
+
+// Copies the matrix into consecutive panels: panel p holds columns
+// [p * MatrixPanelWidth, (p + 1) * MatrixPanelWidth) row by row, columns past
+// the end are padded with zeros.
+std::vector<uint64_t> packPanels(const Matrix& matrix) {
+  const size_t size = matrix.size();
+  const size_t nPanels = (size + MatrixPanelWidth - 1) / MatrixPanelWidth;
+
+  std::vector<uint64_t> panels(nPanels * size * MatrixPanelWidth, 0);
+  for (size_t panel = 0; panel < nPanels; ++panel) {
+    const size_t columnBegin = panel * MatrixPanelWidth;
+    const size_t width = std::min(MatrixPanelWidth, size - columnBegin);
+
+    uint64_t* panelBegin = panels.data() + panel * size * MatrixPanelWidth;
+    for (size_t k = 0; k < size; ++k) {
+      std::copy(matrix[k] + columnBegin, matrix[k] + columnBegin + width,
+                panelBegin + k * MatrixPanelWidth);
+    }
+  }
+
+  return panels;
 }
 
-template <typename T>
-Matrix<T> operator*(const Matrix<T>& first, const Matrix<T>& second) {
-  Matrix<T> res = first;
+// Values below 2^32: every product fits 64 bits, its low and high 32-bit halves
+// are summed in separate 64-bit lanes. Together they form a 96-bit accumulator
+// that can take 2^32 terms, so each dot product is reduced exactly once.
+void multiplyNarrowPanel(const Matrix& first, const uint64_t* panel,
+                         size_t columnBegin, size_t rowBegin, size_t rowEnd,
+                         Matrix& res) {
+  const size_t size = first.size();
+  const size_t width = std::min(MatrixPanelWidth, size - columnBegin);
+  const BarrettReduction& reduction = first.reduction();
+  const uint64_t lowMask = (uint64_t{1} << 32) - 1;
+
+  for (size_t i = rowBegin; i < rowEnd; ++i) {
+    const uint64_t* firstRow = first[i];
+
+    uint64_t low[MatrixPanelWidth] = {};
+    uint64_t high[MatrixPanelWidth] = {};
+
+#ifdef __AVX2__
+    const __m256i lowMaskVec = _mm256_set1_epi64x(lowMask);
+
+    __m256i lowVec[MatrixPanelWidth / 4];
+    __m256i highVec[MatrixPanelWidth / 4];
+    for (size_t part = 0; part < MatrixPanelWidth / 4; ++part) {
+      lowVec[part] = _mm256_setzero_si256();
+      highVec[part] = _mm256_setzero_si256();
+    }
+
+    for (size_t k = 0; k < size; ++k) {
+      const __m256i factor = _mm256_set1_epi64x(firstRow[k]);
+      const uint64_t* secondRow = panel + k * MatrixPanelWidth;
 
-  size_t size = res.size();
-  for (size_t i = 0; i < size; ++i) {
-    for (size_t j = 0; j < size; ++j) {
-      res.matrix_[i][j] = first.matrix_[i][0] * second.matrix_[0][j];
-      for (size_t k = 1; k < size; ++k) {
-        res.matrix_[i][j] += first.matrix_[i][k] * second.matrix_[k][j];
+      for (size_t part = 0; part < MatrixPanelWidth / 4; ++part) {
+        __m256i value = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(secondRow + 4 * part));
+        __m256i product = _mm256_mul_epu32(factor, value);
+
+        lowVec[part] = _mm256_add_epi64(
+            lowVec[part], _mm256_and_si256(product, lowMaskVec));
+        highVec[part] =
+            _mm256_add_epi64(highVec[part], _mm256_srli_epi64(product, 32));
+      }
+    }
+
+    for (size_t part = 0; part < MatrixPanelWidth / 4; ++part) {
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(low + 4 * part),
+                          lowVec[part]);
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(high + 4 * part),
+                          highVec[part]);
+    }
+#else
+    for (size_t k = 0; k < size; ++k) {
+      const uint64_t factor = firstRow[k];
+      const uint64_t* secondRow = panel + k * MatrixPanelWidth;
+
+      for (size_t j = 0; j < MatrixPanelWidth; ++j) {
+        uint64_t product = factor * secondRow[j];
+        low[j] += product & lowMask;
+        high[j] += product >> 32;
+      }
+    }
+#endif
+
+    uint64_t* resRow = res[i] + columnBegin;
+    for (size_t j = 0; j < width; ++j) {
+      uint64_t highPart = reduction.reduce(high[j]);
+      resRow[j] = reduction.add(reduction.reduce(highPart << 32),
+                                reduction.reduce(low[j]));
+    }
+  }
+}
+
+// Values up to 2^63: products are summed in an unsigned __int128 that is
+// reduced once per block of WideBlockTerms terms, 4 products below 2^126 can
+// not overflow it.
+void multiplyWidePanel(const Matrix& first, const uint64_t* panel,
+                       size_t columnBegin, size_t rowBegin, size_t rowEnd,
+                       Matrix& res) {
+  static const size_t WideBlockTerms = 3;
+
+  const size_t size = first.size();
+  const size_t width = std::min(MatrixPanelWidth, size - columnBegin);
+  const BarrettReduction& reduction = first.reduction();
+
+  for (size_t i = rowBegin; i < rowEnd; ++i) {
+    const uint64_t* firstRow = first[i];
+
+    unsigned __int128 sums[MatrixPanelWidth] = {};
+    for (size_t k = 0; k < size; ++k) {
+      const uint64_t* secondRow = panel + k * MatrixPanelWidth;
+
+      for (size_t j = 0; j < width; ++j) {
+        sums[j] += static_cast<unsigned __int128>(firstRow[k]) * secondRow[j];
+      }
+
+      if ((k + 1) % WideBlockTerms == 0) {
+        for (size_t j = 0; j < width; ++j) {
+          sums[j] = reduction.reduce(sums[j]);
+        }
+      }
+    }
+
+    uint64_t* resRow = res[i] + columnBegin;
+    for (size_t j = 0; j < width; ++j) {
+      resRow[j] = reduction.reduce(sums[j]);
+    }
+  }
+}
+
+Matrix operator*(const Matrix& first, const Matrix& second) {
+  assert(first.size() == second.size());
+  assert(first.reduction().mod() == second.reduction().mod());
+
+  const size_t size = first.size();
+  Matrix res(size, first.reduction(), 0, first.threadPool());
+
+  const bool isNarrow = first.reduction().mod() <= (uint64_t{1} << 32);
+  const std::vector<uint64_t> panels = packPanels(second);
+
+  // every row block walks all panels, blocks write disjoint rows of res so the
+  // result does not depend on the number of threads
+  auto multiplyRowBlock = [&](size_t block) {
+    const size_t rowBegin = block * MatrixRowBlock;
+    const size_t rowEnd = std::min(size, rowBegin + MatrixRowBlock);
+
+    for (size_t columnBegin = 0; columnBegin < size;
+         columnBegin += MatrixPanelWidth) {
+      const uint64_t* panel = panels.data() + columnBegin * size;
+
+      if (isNarrow) {
+        multiplyNarrowPanel(first, panel, columnBegin, rowBegin, rowEnd, res);
+      } else {
+        multiplyWidePanel(first, panel, columnBegin, rowBegin, rowEnd, res);
       }
     }
+  };
+
+  const size_t nRowBlocks = (size + MatrixRowBlock - 1) / MatrixRowBlock;
+  if (first.threadPool() != nullptr) {
+    first.threadPool()->parallelFor(nRowBlocks, multiplyRowBlock);
+  } else {
+    for (size_t block = 0; block < nRowBlocks; ++block) {
+      multiplyRowBlock(block);
+    }
   }
 
   return res;
 }
 
-template <typename T>
-Matrix<T>& Matrix<T>::operator*=(const Matrix<T>& other) {
+Matrix& Matrix::operator*=(const Matrix& other) {
   return *this = *this * other;
 }
 
-template <typename T>
-T pow(const T& value, const T& neutralValue, const std::string& binaryPower) {
+// matrix * column, one reduction per row with the accumulators of the
+// matrix product kernels
+std::vector<uint64_t> operator*(const Matrix& matrix,
+                                const std::vector<uint64_t>& column) {
+  const size_t size = matrix.size();
+  const BarrettReduction& reduction = matrix.reduction();
+  assert(column.size() == size);
+
+  std::vector<uint64_t> res(size);
+
+  if (reduction.mod() <= (uint64_t{1} << 32)) {
+    const uint64_t lowMask = (uint64_t{1} << 32) - 1;
+
+    for (size_t i = 0; i < size; ++i) {
+      const uint64_t* row = matrix[i];
+
+      uint64_t low = 0, high = 0;
+      for (size_t j = 0; j < size; ++j) {
+        uint64_t product = row[j] * column[j];
+        low += product & lowMask;
+        high += product >> 32;
+      }
+
+      uint64_t highPart = reduction.reduce(high);
+      res[i] = reduction.add(reduction.reduce(highPart << 32),
+                             reduction.reduce(low));
+    }
+  } else {
+    for (size_t i = 0; i < size; ++i) {
+      const uint64_t* row = matrix[i];
+
+      unsigned __int128 sum = 0;
+      for (size_t j = 0; j < size; ++j) {
+        sum += static_cast<unsigned __int128>(row[j]) * column[j];
+        if ((j + 1) % 3 == 0) {
+          sum = reduction.reduce(sum);
+        }
+      }
+
+      res[i] = reduction.reduce(sum);
+    }
+  }
+
+  return res;
+}
+
+// binaryPower is a range of bits starting from the least significant one
+template <typename T, typename BitRange>
+T pow(const T& value, const T& neutralValue, const BitRange& binaryPower) {
   T result = neutralValue;
 
   T val = value;
 
-  for (size_t i = 0; i < binaryPower.size(); ++i) {
-    assert(binaryPower[i] == '1' || binaryPower[i] == '0');
-
-    if (binaryPower[i] == '1') {
+  auto bitIt = binaryPower.begin();
+  const auto bitsEnd = binaryPower.end();
+  while (bitIt != bitsEnd) {
+    if (*bitIt) {
       result *= val;
     }
 
-    val *= val;
+    ++bitIt;
+    if (bitIt != bitsEnd) {
+      val *= val;
+    }
   }
 
   return result;
 }
 
-Matrix<ModuloRingUint64> FillRecurrentMatrix(const uint32_t width,
-                                             const uint32_t mod) {
+// profile2 may follow profile1 when no 2x2 square of their adjacent rows has
+// a single colour
+bool canFollow(const uint32_t profile1, const uint32_t profile2,
+               const uint32_t nProfiles) {
+  for (uint32_t mask = 1; mask < nProfiles / 2; mask *= 2) {
+    uint32_t squareTopLeft = (profile1 & mask) ? 1 : 0;
+    uint32_t squareTopRight = (profile2 & mask) ? 1 : 0;
+    uint32_t newMask = mask * 2;
+    uint32_t squareBottomLeft = (profile1 & newMask) ? 1 : 0;
+    uint32_t squareBottomRight = (profile2 & newMask) ? 1 : 0;
+
+    if (squareTopLeft == squareTopRight &&
+        squareTopRight == squareBottomLeft &&
+        squareBottomLeft == squareBottomRight) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+Matrix FillRecurrentMatrix(const uint32_t width,
+                           const BarrettReduction& reduction,
+                           ThreadPool* threadPool = nullptr) {
   uint32_t nProfiles = (1 << width);
 
-  Matrix<ModuloRingUint64> profileStep(nProfiles, ModuloRingUint64{1, mod});
+  Matrix profileStep(nProfiles, reduction, 1, threadPool);
 
   for (uint32_t profile1 = 0; profile1 < nProfiles; profile1++) {
     for (uint32_t profile2 = 0; profile2 < nProfiles; profile2++) {
-      for (uint32_t mask = 1; mask < nProfiles / 2; mask *= 2) {
-        uint32_t squareTopLeft = (profile1 & mask) ? 1 : 0;
-        uint32_t squareTopRight = (profile2 & mask) ? 1 : 0;
-        uint32_t newMask = mask * 2;
-        uint32_t squareBottomLeft = (profile1 & newMask) ? 1 : 0;
-        uint32_t squareBottomRight = (profile2 & newMask) ? 1 : 0;
-
-        if (squareTopLeft == squareTopRight &&
-            squareTopRight == squareBottomLeft &&
-            squareBottomLeft == squareBottomRight) {
-          profileStep[profile1][profile2] = ModuloRingUint64{0, mod};
-          break;
-        }
+      if (!canFollow(profile1, profile2, nProfiles)) {
+        profileStep[profile1][profile2] = 0;
       }
     }
   }
@@ -229,54 +843,520 @@ Matrix<ModuloRingUint64> FillRecurrentMatrix(const uint32_t width,
   return profileStep;
 }
 
-Matrix<ModuloRingUint64> createIdentityMatrix(const size_t size,
-                                              const uint32_t mod) {
-  Matrix<ModuloRingUint64> res(size, ModuloRingUint64{0, mod});
+// Profiles split into orbits under colour complement and vertical reflection.
+// Applying the same symmetry to both profiles keeps canFollow unchanged.
+struct ProfileOrbits {
+  std::vector<uint32_t> representatives;
+  std::vector<uint32_t> sizes;
+  // index of the orbit of every profile
+  std::vector<uint32_t> orbitOf;
+};
+
+uint32_t reflectProfile(uint32_t profile, const uint32_t width) {
+  uint32_t reflected = 0;
+  for (uint32_t i = 0; i < width; ++i, profile >>= 1) {
+    reflected = (reflected << 1) | (profile & 1);
+  }
+
+  return reflected;
+}
+
+ProfileOrbits findProfileOrbits(const uint32_t width) {
+  const uint32_t nProfiles = (1 << width);
+  const uint32_t allColoursMask = nProfiles - 1;
+  const uint32_t notVisited = UINT32_MAX;
+
+  ProfileOrbits orbits;
+  orbits.orbitOf.assign(nProfiles, notVisited);
+
+  for (uint32_t profile = 0; profile < nProfiles; ++profile) {
+    if (orbits.orbitOf[profile] != notVisited) {
+      continue;
+    }
+
+    uint32_t reflected = reflectProfile(profile, width);
+    uint32_t orbit[] = {profile, profile ^ allColoursMask, reflected,
+                        reflected ^ allColoursMask};
+
+    uint32_t orbitIndex = orbits.representatives.size();
+    orbits.representatives.push_back(profile);
+    orbits.sizes.push_back(0);
+
+    for (uint32_t member : orbit) {
+      if (orbits.orbitOf[member] == notVisited) {
+        orbits.orbitOf[member] = orbitIndex;
+        ++orbits.sizes[orbitIndex];
+      }
+    }
+  }
+
+  return orbits;
+}
+
+// Transfer matrix acting on profile vectors that are constant on orbits:
+// step[a][b] = number of profiles of orbit b that may follow the
+// representative of orbit a. The full answer is sum over a of
+// sizes[a] * (step^(h - 1) * 1)[a].
+Matrix FillReducedRecurrentMatrix(const uint32_t width,
+                                  const ProfileOrbits& orbits,
+                                  const BarrettReduction& reduction,
+                                  ThreadPool* threadPool = nullptr) {
+  uint32_t nProfiles = (1 << width);
+
+  Matrix profileStep(orbits.representatives.size(), reduction, 0, threadPool);
+
+  for (size_t orbit = 0; orbit < orbits.representatives.size(); ++orbit) {
+    uint32_t profile1 = orbits.representatives[orbit];
+
+    for (uint32_t profile2 = 0; profile2 < nProfiles; profile2++) {
+      if (canFollow(profile1, profile2, nProfiles)) {
+        uint64_t& entry = profileStep[orbit][orbits.orbitOf[profile2]];
+        entry = reduction.add(entry, 1 % reduction.mod());
+      }
+    }
+  }
+
+  return profileStep;
+}
+
+Matrix createIdentityMatrix(const size_t size,
+                            const BarrettReduction& reduction,
+                            ThreadPool* threadPool = nullptr) {
+  Matrix res(size, reduction, 0, threadPool);
   for (size_t i = 0; i < size; ++i) {
-    res[i][i] = {1, mod};
+    res[i][i] = 1 % reduction.mod();
   }
 
   return res;
 }
 
+struct SolverOptions {
+  size_t nThreads = 1;
+  // exponentiate the transfer matrix over profile orbits, see ProfileOrbits
+  bool useSymmetryReduction = false;
+  // input is "width mod" followed by any number of heights
+  bool isBatchMode = false;
+  // evaluate the minimal linear recurrence of the answers instead of matrix
+  // powers, only for prime moduli
+  bool useMinimalPolynomial = false;
+};
+
+// std::nullopt on an unknown option
+std::optional<SolverOptions> parseOptions(int argc, char* argv[]) {
+  SolverOptions options;
+
+  for (int i = 1; i < argc; ++i) {
+    std::string_view option = argv[i];
+
+    if (option == "--threads" && i + 1 < argc) {
+      options.nThreads = std::max<size_t>(1, std::stoul(argv[++i]));
+    } else if (option == "--symmetry") {
+      options.useSymmetryReduction = true;
+    } else if (option == "--batch") {
+      options.isBatchMode = true;
+    } else if (option == "--berlekamp-massey") {
+      options.useMinimalPolynomial = true;
+    } else {
+      std::cerr << "Unknown option " << option << "\n";
+      return std::nullopt;
+    }
+  }
+
+  return options;
+}
+
+struct TransferMatrix {
+  Matrix matrix;
+  // weight of every row of the matrix in the final sum
+  std::vector<uint32_t> rowWeights;
+};
+
+TransferMatrix buildTransferMatrix(const uint32_t width,
+                                   const BarrettReduction& reduction,
+                                   const SolverOptions& options,
+                                   ThreadPool* threadPool) {
+  if (options.useSymmetryReduction) {
+    ProfileOrbits orbits = findProfileOrbits(width);
+
+    return {FillReducedRecurrentMatrix(width, orbits, reduction, threadPool),
+            orbits.sizes};
+  }
+
+  Matrix matrix = FillRecurrentMatrix(width, reduction, threadPool);
+  std::vector<uint32_t> rowWeights(matrix.size(), 1);
+
+  return {std::move(matrix), std::move(rowWeights)};
+}
+
+uint64_t powMod(uint64_t base, uint64_t exponent,
+               const BarrettReduction& reduction) {
+  uint64_t result = 1 % reduction.mod();
+
+  while (exponent != 0) {
+    if (exponent % 2 == 1) {
+      result = reduction.multiply(result, base);
+    }
+
+    base = reduction.multiply(base, base);
+    exponent /= 2;
+  }
+
+  return result;
+}
+
+// Miller-Rabin, the first twelve primes as bases are exact below 2^64
+bool isPrime(const uint64_t value) {
+  const uint64_t bases[] = {2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37};
+
+  if (value < 2) {
+    return false;
+  }
+  for (uint64_t base : bases) {
+    if (value % base == 0) {
+      return value == base;
+    }
+  }
+
+  BarrettReduction reduction(value);
+
+  uint64_t oddPart = value - 1;
+  size_t nTwos = 0;
+  while (oddPart % 2 == 0) {
+    oddPart /= 2;
+    ++nTwos;
+  }
+
+  for (uint64_t base : bases) {
+    uint64_t power = powMod(base, oddPart, reduction);
+    if (power == 1 || power == value - 1) {
+      continue;
+    }
+
+    bool isWitness = true;
+    for (size_t i = 1; i < nTwos && isWitness; ++i) {
+      power = reduction.multiply(power, power);
+      isWitness = power != value - 1;
+    }
+
+    if (isWitness) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// terms[t] = sum of c[i] * terms[t - 1 - i] over i < c.size()
+struct LinearRecurrence {
+  std::vector<uint64_t> coefficients;
+  std::vector<uint64_t> initialTerms;
+};
+
+// Berlekamp-Massey over the prime field of reduction: the shortest recurrence
+// that generates terms. A sequence of order at most S is determined by its
+// first 2S terms.
+LinearRecurrence findLinearRecurrence(const std::vector<uint64_t>& terms,
+                                      const BarrettReduction& reduction) {
+  const uint64_t mod = reduction.mod();
+  auto subtract = [&reduction](uint64_t a, uint64_t b) {
+    return reduction.add(a, b == 0 ? 0 : reduction.mod() - b);
+  };
+
+  // connection polynomials 1 - c_1 x - ... as coefficient lists
+  std::vector<uint64_t> current = {1 % mod};
+  std::vector<uint64_t> previous = {1 % mod};
+  size_t order = 0;
+  // discrepancy when previous was current, and the steps since then
+  uint64_t previousDiscrepancy = 1 % mod;
+  size_t shift = 1;
+
+  for (size_t t = 0; t < terms.size(); ++t) {
+    uint64_t discrepancy = 0;
+    for (size_t i = 0; i <= order && i < current.size(); ++i) {
+      discrepancy = reduction.add(
+          discrepancy, reduction.multiply(current[i], terms[t - i]));
+    }
+
+    if (discrepancy == 0) {
+      ++shift;
+      continue;
+    }
+
+    uint64_t scale = reduction.multiply(
+        discrepancy, powMod(previousDiscrepancy, mod - 2, reduction));
+
+    std::vector<uint64_t> updated = current;
+    if (updated.size() < previous.size() + shift) {
+      updated.resize(previous.size() + shift, 0);
+    }
+    for (size_t i = 0; i < previous.size(); ++i) {
+      updated[i + shift] = subtract(updated[i + shift],
+                                    reduction.multiply(scale, previous[i]));
+    }
+
+    if (2 * order <= t) {
+      previous = std::move(current);
+      previousDiscrepancy = discrepancy;
+      order = t + 1 - order;
+      shift = 1;
+    } else {
+      ++shift;
+    }
+
+    current = std::move(updated);
+  }
+
+  LinearRecurrence recurrence;
+  current.resize(order + 1, 0);
+  for (size_t i = 1; i <= order; ++i) {
+    recurrence.coefficients.push_back(subtract(0, current[i]));
+  }
+  recurrence.initialTerms.assign(terms.begin(), terms.begin() + order);
+
+  return recurrence;
+}
+
+// a * b modulo x^L - c_1 x^(L-1) - ... - c_L, both of degree below L
+std::vector<uint64_t> multiplyModCharacteristic(
+    const std::vector<uint64_t>& a, const std::vector<uint64_t>& b,
+    const LinearRecurrence& recurrence, const BarrettReduction& reduction) {
+  const std::vector<uint64_t>& coefficients = recurrence.coefficients;
+  const size_t order = coefficients.size();
+
+  std::vector<uint64_t> product(2 * order - 1, 0);
+  for (size_t i = 0; i < order; ++i) {
+    for (size_t j = 0; j < order; ++j) {
+      product[i + j] = reduction.add(product[i + j],
+                                     reduction.multiply(a[i], b[j]));
+    }
+  }
+
+  // x^d = sum of c_i x^(d - i)
+  for (size_t degree = product.size(); degree-- > order;) {
+    for (size_t i = 1; i <= order; ++i) {
+      product[degree - i] = reduction.add(
+          product[degree - i],
+          reduction.multiply(product[degree], coefficients[i - 1]));
+    }
+  }
+
+  product.resize(order);
+  return product;
+}
+
+// term with the given index through x^index modulo the characteristic
+// polynomial: O(L^2) per bit of index
+uint64_t getRecurrenceTerm(const LinearRecurrence& recurrence,
+                           const BinaryBigInt& index,
+                           const BarrettReduction& reduction) {
+  const std::vector<uint64_t>& coefficients = recurrence.coefficients;
+  const size_t order = coefficients.size();
+  if (order == 0) {
+    return 0;
+  }
+
+  std::vector<uint64_t> power(order, 0);
+  power[0] = 1 % reduction.mod();
+
+  for (size_t bit = index.bitLength(); bit-- > 0;) {
+    power = multiplyModCharacteristic(power, power, recurrence, reduction);
+
+    if (index.bit(bit)) {
+      // multiplication by x
+      uint64_t top = power[order - 1];
+      for (size_t i = order - 1; i > 0; --i) {
+        power[i] = reduction.add(
+            power[i - 1], reduction.multiply(top, coefficients[order - 1 - i]));
+      }
+      power[0] = reduction.multiply(top, coefficients[order - 1]);
+    }
+  }
+
+  uint64_t term = 0;
+  for (size_t i = 0; i < order; ++i) {
+    term = reduction.add(
+        term, reduction.multiply(power[i], recurrence.initialTerms[i]));
+  }
+
+  return term;
+}
+
+// answers for heights 1, 2, ... satisfy the recurrence given by the minimal
+// polynomial of the transfer matrix, its order is at most the matrix size
+LinearRecurrence findAnswerRecurrence(const TransferMatrix& transferMatrix,
+                                      const BarrettReduction& reduction) {
+  const Matrix& matrix = transferMatrix.matrix;
+
+  std::vector<uint64_t> column(matrix.size(), 1 % reduction.mod());
+  std::vector<uint64_t> terms(2 * matrix.size());
+  for (size_t t = 0; t < terms.size(); ++t) {
+    uint64_t term = 0;
+    for (size_t i = 0; i < column.size(); ++i) {
+      term = reduction.add(
+          term, reduction.multiply(column[i], transferMatrix.rowWeights[i]));
+    }
+
+    terms[t] = term;
+    column = matrix * column;
+  }
+
+  return findLinearRecurrence(terms, reduction);
+}
+
 uint64_t getInfluencingOptionsAmount(const DecimalBigInt& height,
-                                     const uint32_t width, const uint32_t mod) {
+                                     const uint32_t width, const uint64_t mod,
+                                     const SolverOptions& options = {}) {
   using RingType = ModuloRingUint64;
 
-  Matrix<RingType> recurrentMatrix = FillRecurrentMatrix(width, mod);
+  BarrettReduction reduction(mod);
+  ThreadPool threadPool(options.nThreads);
+
+  TransferMatrix transferMatrix =
+      buildTransferMatrix(width, reduction, options, &threadPool);
 
-  DecimalBigInt newHeight = height;
+  BinaryBigInt newHeight = height.convertToBinary();
   --newHeight;
 
   if (newHeight.isZero()) {
     return (1 << width) % mod;
   }
 
-  auto identityMatrix = createIdentityMatrix(recurrentMatrix.size(), mod);
+  if (options.useMinimalPolynomial && isPrime(mod)) {
+    return getRecurrenceTerm(findAnswerRecurrence(transferMatrix, reduction),
+                             newHeight, reduction);
+  }
+
+  auto& [recurrentMatrix, rowWeights] = transferMatrix;
+
+  auto identityMatrix =
+      createIdentityMatrix(recurrentMatrix.size(), reduction, &threadPool);
 
-  Matrix<RingType> resultMatrix =
-      pow(recurrentMatrix, identityMatrix, newHeight.convertToBinary());
+  Matrix resultMatrix =
+      pow(recurrentMatrix, identityMatrix, newHeight);
 
   size_t matrixSize = resultMatrix.size();
 
-  RingType answer{0, mod};
+  RingType answer{0, reduction};
 
   for (size_t i = 0; i < matrixSize; ++i) {
+    RingType rowSum{0, reduction};
     for (size_t j = 0; j < matrixSize; ++j) {
-      answer += resultMatrix[i][j];
+      rowSum += RingType{resultMatrix[i][j], reduction};
     }
+
+    answer += rowSum * RingType{rowWeights[i], reduction};
   }
 
   return answer.value();
 }
 
-int main() {
+// Answers many heights for one (width, mod): the transfer matrix is built once
+// and its powers M^(2^k) are cached, growing as bigger heights arrive. A height
+// h costs one matrix-vector product per set bit of h - 1.
+class HeightQueryEngine {
+ public:
+  HeightQueryEngine(const uint32_t width, const uint64_t mod,
+                    const SolverOptions& options);
+
+  uint64_t getInfluencingOptionsAmount(const DecimalBigInt& height);
+
+ private:
+  const Matrix& getLadderStep(size_t bit);
+
+  BarrettReduction reduction_;
+  ThreadPool threadPool_;
+  std::vector<uint32_t> rowWeights_;
+  // ladder_[k] = M^(2^k)
+  std::vector<Matrix> ladder_;
+  // set instead of the ladder when the answers are taken from their recurrence
+  bool useRecurrence_ = false;
+  LinearRecurrence recurrence_;
+};
+
+HeightQueryEngine::HeightQueryEngine(const uint32_t width, const uint64_t mod,
+                                     const SolverOptions& options)
+    : reduction_(mod), threadPool_(options.nThreads) {
+  TransferMatrix transferMatrix =
+      buildTransferMatrix(width, reduction_, options, &threadPool_);
+
+  if (options.useMinimalPolynomial && isPrime(mod)) {
+    useRecurrence_ = true;
+    recurrence_ = findAnswerRecurrence(transferMatrix, reduction_);
+  }
+
+  ladder_.push_back(std::move(transferMatrix.matrix));
+  rowWeights_ = std::move(transferMatrix.rowWeights);
+}
+
+const Matrix& HeightQueryEngine::getLadderStep(size_t bit) {
+  while (ladder_.size() <= bit) {
+    ladder_.push_back(ladder_.back() * ladder_.back());
+  }
+
+  return ladder_[bit];
+}
+
+uint64_t HeightQueryEngine::getInfluencingOptionsAmount(
+    const DecimalBigInt& height) {
+  using RingType = ModuloRingUint64;
+
+  BinaryBigInt newHeight = height.convertToBinary();
+  --newHeight;
+
+  if (useRecurrence_) {
+    return getRecurrenceTerm(recurrence_, newHeight, reduction_);
+  }
+
+  // powers of M commute, so the set bits can be applied in any order
+  std::vector<uint64_t> column(rowWeights_.size(), 1 % reduction_.mod());
+  size_t bit = 0;
+  for (bool isSet : newHeight) {
+    if (isSet) {
+      column = getLadderStep(bit) * column;
+    }
+    ++bit;
+  }
+
+  RingType answer{0, reduction_};
+  for (size_t i = 0; i < column.size(); ++i) {
+    answer += RingType{column[i], reduction_} *
+              RingType{rowWeights_[i], reduction_};
+  }
+
+  return answer.value();
+}
+
+int main(int argc, char* argv[]) {
+  std::optional<SolverOptions> parsedOptions = parseOptions(argc, argv);
+  if (!parsedOptions) {
+    return 1;
+  }
+  const SolverOptions& options = *parsedOptions;
+
+  if (options.isBatchMode) {
+    uint32_t m = 0;
+    uint64_t mod = 0;
+    std::cin >> m >> mod;
+
+    HeightQueryEngine engine(m, mod, options);
+
+    std::string height;
+    while (std::cin >> height) {
+      std::cout << engine.getInfluencingOptionsAmount(height) << "\n"
+                << std::flush;
+    }
+
+    return 0;
+  }
+
   std::string n;
-  uint32_t m = 0, mod = 0;
+  uint32_t m = 0;
+  uint64_t mod = 0;
   std::cin >> n;
   std::cin >> m >> mod;
 
-  uint64_t influencingOptionsAmount = getInfluencingOptionsAmount(n, m, mod);
+  uint64_t influencingOptionsAmount =
+      getInfluencingOptionsAmount(n, m, mod, options);
 
   std::cout << influencingOptionsAmount << "\n";
 
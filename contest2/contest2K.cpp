@@ -1,6 +1,9 @@
 #include <algorithm>
+#include <bit>
 #include <cassert>
+#include <cstdint>
 #include <iostream>
+#include <string>
 #include <vector>
 
 struct Point {
@@ -9,117 +12,402 @@ struct Point {
   explicit Point(int x = 0, int y = 0) : x(x), y(y) {}
 };
 
+template <typename T>
 struct Line {
-  int slopeFactor, yOffset;
+  T slopeFactor, yOffset;
 
-  explicit Line(int slopeFactor = 0, int yOffset = 0)
+  explicit Line(T slopeFactor = 0, T yOffset = 0)
       : slopeFactor(slopeFactor), yOffset(yOffset) {}
 
-  int getY(int x) const { return slopeFactor * x + yOffset; }
+  T getY(T x) const { return slopeFactor * x + yOffset; }
 };
 
+// How LowerEnvelope::getY is called
+enum class QueryOrder {
+  // binary search over the intersections
+  Any,
+  // pointer walk over the lines, amortized O(1)
+  NonDecreasingX,
+};
+
+// Minimum of lines added with decreasing slopes. Evaluates lines only
+// at query points, comparisons while adding use intersections alone, so T
+// only has to hold the values at the queried x
+template <typename T>
 class LowerEnvelope {
  public:
-  LowerEnvelope();
+  explicit LowerEnvelope(QueryOrder queryOrder = QueryOrder::Any);
+
+  void addLine(const Line<T>& line);
 
-  void addLine(const Line& line);
+  T getY(T x) const;
 
-  int getY(int x) const;
+  // keeps the buffers for the next lines
+  void clear();
+
+  void swap(LowerEnvelope& other);
 
  private:
-  std::vector<Line> lines_;
-  std::vector<int> linesIntersectionsX_;
+  QueryOrder queryOrder_;
+  std::vector<Line<T> > lines_;
+  // lines_[i] is the minimum for x after linesIntersectionsX_[i], the first
+  // one is never read
+  std::vector<T> linesIntersectionsX_;
+  mutable size_t queryLineIndex_ = 0;
 };
 
-int findCrossX(const Line& line1, const Line& line2) {
+template <typename T>
+T findCrossX(const Line<T>& line1, const Line<T>& line2) {
   assert(line1.slopeFactor != line2.slopeFactor);
 
-  int x =
+  T x =
       (line2.yOffset - line1.yOffset) / (line1.slopeFactor - line2.slopeFactor);
   if (line2.yOffset - line1.yOffset < 0) --x;
 
   return x;
 }
 
-LowerEnvelope::LowerEnvelope() {
-  static const int inf = 1e9;
-
-  lines_.push_back(Line(0, inf));
-  linesIntersectionsX_.push_back(-inf);
-}
+template <typename T>
+LowerEnvelope<T>::LowerEnvelope(QueryOrder queryOrder)
+    : queryOrder_(queryOrder) {}
 
-void LowerEnvelope::addLine(const Line& line) {
-  int intersectionX = linesIntersectionsX_.back();
+template <typename T>
+void LowerEnvelope<T>::addLine(const Line<T>& line) {
+  assert(lines_.empty() || lines_.back().slopeFactor > line.slopeFactor);
 
-  while (lines_.size() != 0 &&
-         lines_.back().getY(intersectionX) > line.getY(intersectionX)) {
+  // the last line is not needed when the new one is not worse from where the
+  // last one starts. The first line is the minimum for x far enough to the
+  // left, whatever lines come after it
+  while (lines_.size() > 1 &&
+         findCrossX(lines_.back(), line) <= linesIntersectionsX_.back()) {
     lines_.pop_back();
     linesIntersectionsX_.pop_back();
-
-    intersectionX = linesIntersectionsX_.back();
   }
 
-  static const int infinitelyRemotePointX = -1e9;
+  linesIntersectionsX_.push_back(lines_.empty()
+                                     ? T{}
+                                     : findCrossX(lines_.back(), line));
+  lines_.push_back(line);
+}
+
+template <typename T>
+T LowerEnvelope<T>::getY(T x) const {
+  assert(!lines_.empty());
 
-  if (lines_.empty()) {
-    linesIntersectionsX_.push_back(infinitelyRemotePointX);
-  } else {
-    linesIntersectionsX_.push_back(findCrossX(lines_.back(), line));
+  if (queryOrder_ == QueryOrder::NonDecreasingX) {
+    // lines after the pointer may have been replaced by the last added line
+    queryLineIndex_ = std::min(queryLineIndex_, lines_.size() - 1);
+    while (queryLineIndex_ + 1 < lines_.size() &&
+           linesIntersectionsX_[queryLineIndex_ + 1] < x) {
+      ++queryLineIndex_;
+    }
+
+    return lines_[queryLineIndex_].getY(x);
   }
 
-  lines_.push_back(line);
+  size_t lineIndex = std::lower_bound(linesIntersectionsX_.begin() + 1,
+                                      linesIntersectionsX_.end(), x) -
+                     linesIntersectionsX_.begin() - 1;
+
+  return lines_[lineIndex].getY(x);
 }
 
-int LowerEnvelope::getY(int x) const {
-  int lineIndex = std::lower_bound(linesIntersectionsX_.begin(),
-                                   linesIntersectionsX_.end(), x) -
-                  linesIntersectionsX_.begin() - 1;
+template <typename T>
+void LowerEnvelope<T>::clear() {
+  lines_.clear();
+  linesIntersectionsX_.clear();
+  queryLineIndex_ = 0;
+}
 
-  return lines_[lineIndex].getY(x);
+template <typename T>
+void LowerEnvelope<T>::swap(LowerEnvelope& other) {
+  std::swap(queryOrder_, other.queryOrder_);
+  lines_.swap(other.lines_);
+  linesIntersectionsX_.swap(other.linesIntersectionsX_);
+  std::swap(queryLineIndex_, other.queryLineIndex_);
 }
 
-int findMinSquareLens(const size_t nPoints, const size_t nSegments) {
-  if (nSegments == 0) {
-    return 0;
-  }
+// Minimum of lines on the integer x of [minX, maxX] for lines and queries in
+// any order, O(log(maxX - minX)) each. Node i covers a range of x, its
+// halves are nodes 2i and 2i + 1, and it keeps the line that is lower at
+// the middle of the range
+template <typename T>
+class LiChaoTree {
+ public:
+  LiChaoTree(T minX, T maxX);
 
-  static const int infDpVal = 1e9;
+  void addLine(Line<T> line);
 
-  std::vector<std::vector<int> > dp(nPoints + 1,
-                                    std::vector<int>(nSegments + 1, infDpVal));
+  T getY(T x) const;
 
-  LowerEnvelope envelope;
+  // keeps the buffers for the next lines
+  void clear();
 
-  for (int i = 0; i <= nSegments; ++i) {
-    dp[0][i] = 0;
+  void swap(LiChaoTree& other);
+
+ private:
+  T minX_, maxX_;
+  std::vector<Line<T> > nodesLines_;
+  std::vector<bool> hasLine_;
+};
+
+template <typename T>
+LiChaoTree<T>::LiChaoTree(T minX, T maxX)
+    : minX_(minX),
+      maxX_(maxX),
+      nodesLines_(4 * static_cast<size_t>(maxX - minX + 1)),
+      hasLine_(nodesLines_.size(), false) {
+  assert(minX <= maxX);
+}
+
+template <typename T>
+void LiChaoTree<T>::addLine(Line<T> line) {
+  size_t node = 1;
+  T lo = minX_, hi = maxX_;
+  while (hasLine_[node]) {
+    T mid = lo + (hi - lo) / 2;
+    Line<T>& nodeLine = nodesLines_[node];
+
+    bool isLowerAtLo = line.getY(lo) < nodeLine.getY(lo);
+    bool isLowerAtMid = line.getY(mid) < nodeLine.getY(mid);
+    if (isLowerAtMid) {
+      std::swap(line, nodeLine);
+    }
+
+    if (lo == hi) {
+      return;
+    }
+
+    // the line kept here is lower at mid, the other one can only be lower
+    // on the side where the two cross
+    if (isLowerAtLo != isLowerAtMid) {
+      node = 2 * node;
+      hi = mid;
+    } else {
+      node = 2 * node + 1;
+      lo = mid + 1;
+    }
+  }
+
+  nodesLines_[node] = line;
+  hasLine_[node] = true;
+}
+
+template <typename T>
+T LiChaoTree<T>::getY(T x) const {
+  assert(minX_ <= x && x <= maxX_ && hasLine_[1]);
+
+  T y = nodesLines_[1].getY(x);
+  size_t node = 1;
+  T lo = minX_, hi = maxX_;
+  while (lo != hi) {
+    T mid = lo + (hi - lo) / 2;
+    if (x <= mid) {
+      node = 2 * node;
+      hi = mid;
+    } else {
+      node = 2 * node + 1;
+      lo = mid + 1;
+    }
+
+    if (!hasLine_[node]) {
+      break;
+    }
+    y = std::min(y, nodesLines_[node].getY(x));
   }
 
-  static const Line zeroPointsLine{-2 * 1, 0 + 1 * 1};
+  return y;
+}
+
+template <typename T>
+void LiChaoTree<T>::clear() {
+  std::fill(hasLine_.begin(), hasLine_.end(), false);
+}
+
+template <typename T>
+void LiChaoTree<T>::swap(LiChaoTree& other) {
+  std::swap(minX_, other.minX_);
+  std::swap(maxX_, other.maxX_);
+  nodesLines_.swap(other.nodesLines_);
+  hasLine_.swap(other.hasLine_);
+}
+
+// line of the points before pointId + 1 covered with squareLens
+Line<int64_t> getNextSegmentLine(int64_t pointId, int64_t squareLens) {
+  return Line<int64_t>{-2 * (pointId + 1),
+                       squareLens + (pointId + 1) * (pointId + 1)};
+}
+
+// One convex hull trick layer per segment, O(nPoints * nSegments). The two
+// envelopes come empty and swap roles every layer
+template <typename Envelope>
+int64_t findMinSquareLensByLayers(const size_t nPoints, const size_t nSegments,
+                                  Envelope& envelope, Envelope& newEnvelope) {
+  static const Line<int64_t> zeroPointsLine = getNextSegmentLine(0, 0);
 
   envelope.addLine(zeroPointsLine);
 
+  int64_t minSquareLens = 0;
   for (size_t nUsedSegments = 1; nUsedSegments <= nSegments; ++nUsedSegments) {
-    LowerEnvelope newEnvelope;
+    newEnvelope.clear();
     newEnvelope.addLine(zeroPointsLine);
 
-    for (size_t pointId = 1; pointId <= nPoints; ++pointId) {
-      dp[pointId][nUsedSegments] = envelope.getY(pointId) + pointId * pointId;
-      newEnvelope.addLine(
-          Line{-2 * (pointId + 1),
-               dp[pointId][nUsedSegments] + (pointId + 1) * (pointId + 1)});
+    for (int64_t pointId = 1; pointId <= static_cast<int64_t>(nPoints);
+         ++pointId) {
+      minSquareLens = envelope.getY(pointId) + pointId * pointId;
+      newEnvelope.addLine(getNextSegmentLine(pointId, minSquareLens));
     }
 
-    envelope = newEnvelope;
+    envelope.swap(newEnvelope);
+  }
+
+  return minSquareLens;
+}
+
+// Minimum over any number of segments of their square lens plus penalty for
+// each segment
+template <typename Envelope>
+int64_t findMinPenalizedSquareLens(const size_t nPoints, int64_t penalty,
+                                   Envelope& envelope) {
+  envelope.clear();
+  envelope.addLine(getNextSegmentLine(0, 0));
+
+  int64_t minSquareLens = 0;
+  for (int64_t pointId = 1; pointId <= static_cast<int64_t>(nPoints);
+       ++pointId) {
+    minSquareLens = envelope.getY(pointId) + pointId * pointId + penalty;
+    envelope.addLine(getNextSegmentLine(pointId, minSquareLens));
   }
 
-  return dp[nPoints][nSegments];
+  return minSquareLens;
 }
 
-int main() {
+// The min square lens is convex in nSegments, so it equals the max over
+// penalties of findMinPenalizedSquareLens(penalty) - penalty * nSegments.
+// That is concave in the penalty, binary search for where it stops growing
+// takes O(nPoints * log(nPoints^2)) instead of a layer per segment
+template <typename Envelope>
+int64_t findMinSquareLensByPenalty(const size_t nPoints, const size_t nSegments,
+                                   Envelope& envelope) {
+  auto getLowerBound = [&](int64_t penalty) {
+    return findMinPenalizedSquareLens(nPoints, penalty, envelope) -
+           penalty * static_cast<int64_t>(nSegments);
+  };
+
+  // no segment saves more than (nPoints - 1)^2
+  int64_t minPenalty = 0;
+  int64_t maxPenalty = static_cast<int64_t>(nPoints) * nPoints;
+  while (minPenalty < maxPenalty) {
+    int64_t penalty = minPenalty + (maxPenalty - minPenalty) / 2;
+    if (getLowerBound(penalty + 1) > getLowerBound(penalty)) {
+      minPenalty = penalty + 1;
+    } else {
+      maxPenalty = penalty;
+    }
+  }
+
+  return getLowerBound(minPenalty);
+}
+
+enum class SquareLensEngine {
+  Auto,
+  Layers,
+  Penalty,
+};
+
+enum class EnvelopeKind {
+  // LowerEnvelope walking to the growing x of the points
+  MonotoneHull,
+  // LowerEnvelope with a binary search per point
+  SearchedHull,
+  LiChaoTree,
+};
+
+struct SquareLensOptions {
+  SquareLensEngine engine = SquareLensEngine::Auto;
+  EnvelopeKind envelopeKind = EnvelopeKind::MonotoneHull;
+};
+
+template <typename Envelope>
+int64_t findMinSquareLensWith(const size_t nPoints, const size_t nSegments,
+                              SquareLensEngine engine, Envelope envelope) {
+  if (engine == SquareLensEngine::Layers) {
+    Envelope newEnvelope = envelope;
+    return findMinSquareLensByLayers(nPoints, nSegments, envelope,
+                                     newEnvelope);
+  }
+
+  return findMinSquareLensByPenalty(nPoints, nSegments, envelope);
+}
+
+int64_t findMinSquareLens(const size_t nPoints, const size_t nSegments,
+                          const SquareLensOptions& options = {}) {
+  if (nSegments == 0 || nPoints == 0) {
+    return 0;
+  }
+
+  SquareLensEngine engine = options.engine;
+
+  if (engine == SquareLensEngine::Auto) {
+    // two passes per step of the penalty search
+    size_t nPenaltyPasses = 2 * std::bit_width(nPoints * nPoints);
+    engine = nSegments <= nPenaltyPasses ? SquareLensEngine::Layers
+                                         : SquareLensEngine::Penalty;
+  }
+
+  switch (options.envelopeKind) {
+    case EnvelopeKind::MonotoneHull:
+      return findMinSquareLensWith(
+          nPoints, nSegments, engine,
+          LowerEnvelope<int64_t>(QueryOrder::NonDecreasingX));
+    case EnvelopeKind::SearchedHull:
+      return findMinSquareLensWith(nPoints, nSegments, engine,
+                                   LowerEnvelope<int64_t>(QueryOrder::Any));
+    case EnvelopeKind::LiChaoTree:
+      return findMinSquareLensWith(
+          nPoints, nSegments, engine,
+          LiChaoTree<int64_t>(1, static_cast<int64_t>(nPoints)));
+  }
+
+  return 0;
+}
+
+int main(int argc, char** argv) {
+  SquareLensOptions options;
+  for (int i = 1; i < argc; ++i) {
+    std::string option = argv[i];
+    if (option == "--engine" && i + 1 < argc) {
+      std::string name = argv[++i];
+      if (name == "layers") {
+        options.engine = SquareLensEngine::Layers;
+      } else if (name == "penalty") {
+        options.engine = SquareLensEngine::Penalty;
+      } else {
+        std::cerr << "Unknown engine " << name << "\n";
+        return 1;
+      }
+    } else if (option == "--envelope" && i + 1 < argc) {
+      std::string name = argv[++i];
+      if (name == "monotone") {
+        options.envelopeKind = EnvelopeKind::MonotoneHull;
+      } else if (name == "search") {
+        options.envelopeKind = EnvelopeKind::SearchedHull;
+      } else if (name == "li-chao") {
+        options.envelopeKind = EnvelopeKind::LiChaoTree;
+      } else {
+        std::cerr << "Unknown envelope " << name << "\n";
+        return 1;
+      }
+    } else {
+      std::cerr << "Unknown option " << option << "\n";
+      return 1;
+    }
+  }
+
   size_t nPoints = 0, nSegments = 0;
   std::cin >> nPoints >> nSegments;
 
-  int minSquareLens = findMinSquareLens(nPoints, nSegments);
+  int64_t minSquareLens = findMinSquareLens(nPoints, nSegments, options);
 
   std::cout << minSquareLens << "\n";
 